@@ -19,8 +19,25 @@ SOURCES += \
     src/ci/NodeEdit.cpp \
     src/includes/includeutils.cpp \
     src/includes/includetree.cpp \
+    src/includes/includegraph.cpp \
     src/includes/includeextractor.cpp \
     src/includes/includemodifier.cpp \
+    src/includes/includeorganizer.cpp \
+    src/includes/includebatch.cpp \
+    src/includes/setcover.cpp \
+    src/includes/includeannotations.cpp \
+    src/includes/filesizecache.cpp \
+    src/includes/lookupcache.cpp \
+    src/includes/includetrace.cpp \
+    src/includes/scopeindex.cpp \
+    src/includes/symbolindex.cpp \
+    src/includes/includesorter.cpp \
+    src/includes/includeoptionspage.cpp \
+    src/includes/includecycles.cpp \
+    src/includes/includefanout.cpp \
+    src/includes/includepch.cpp \
+    src/includes/includeunity.cpp \
+    src/includes/includereportpane.cpp \
     src/scrollbars/scrollbarscolorizer.cpp
 
 HEADERS += \
@@ -41,8 +58,26 @@ HEADERS += \
     src/ci/NodeEdit.h \
     src/includes/includeutils.h \
     src/includes/includetree.h \
+    src/includes/includegraph.h \
+    src/includes/bitset.h \
     src/includes/includeextractor.h \
     src/includes/includemodifier.h \
+    src/includes/includeorganizer.h \
+    src/includes/includebatch.h \
+    src/includes/setcover.h \
+    src/includes/includeannotations.h \
+    src/includes/filesizecache.h \
+    src/includes/lookupcache.h \
+    src/includes/includetrace.h \
+    src/includes/scopeindex.h \
+    src/includes/symbolindex.h \
+    src/includes/includesorter.h \
+    src/includes/includeoptionspage.h \
+    src/includes/includecycles.h \
+    src/includes/includefanout.h \
+    src/includes/includepch.h \
+    src/includes/includeunity.h \
+    src/includes/includereportpane.h \
     src/scrollbars/scrollbarscolorizer.h
 
 TRANSLATIONS += \
@@ -80,7 +115,10 @@ QTC_PLUGIN_RECOMMENDS += \
 
 include($$QTCREATOR_SOURCES/src/qtcreatorplugin.pri)
 
+QT += concurrent
+
 RESOURCES += \
     resources.qrc
 
 CONFIG(release, debug|release):DEFINES += QT_NO_DEBUG_OUTPUT
+includes_tracing:DEFINES += INCLUDES_TRACING
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <QVector>
+#include <QtAlgorithms>
+
+// Fixed size set of small non-negative integers, stored as 64 bit words.
+class Bitset {
+  public:
+    explicit Bitset (int size = 0) :
+      size_ (size),
+      words_ ((size + 63) / 64, 0) {
+    }
+
+    int size () const {
+      return size_;
+    }
+
+    bool test (int bit) const {
+      return words_[bit >> 6] & (quint64 (1) << (bit & 63));
+    }
+
+    void set (int bit) {
+      words_[bit >> 6] |= (quint64 (1) << (bit & 63));
+    }
+
+    void reset (int bit) {
+      words_[bit >> 6] &= ~(quint64 (1) << (bit & 63));
+    }
+
+    void unite (const Bitset &other) {
+      for (auto i = 0, end = words_.size (); i < end; ++i) {
+        words_[i] |= other.words_[i];
+      }
+    }
+
+    void subtract (const Bitset &other) {
+      for (auto i = 0, end = words_.size (); i < end; ++i) {
+        words_[i] &= ~other.words_[i];
+      }
+    }
+
+    bool intersects (const Bitset &other) const {
+      for (auto i = 0, end = words_.size (); i < end; ++i) {
+        if (words_[i] & other.words_[i]) {
+          return true;
+        }
+      }
+      return false;
+    }
+
+    int count () const {
+      auto result = 0;
+      for (const auto word: words_) {
+        result += qPopulationCount (word);
+      }
+      return result;
+    }
+
+    int intersectionCount (const Bitset &other) const {
+      auto result = 0;
+      for (auto i = 0, end = words_.size (); i < end; ++i) {
+        result += qPopulationCount (words_[i] & other.words_[i]);
+      }
+      return result;
+    }
+
+    bool isEmpty () const {
+      for (const auto word: words_) {
+        if (word) {
+          return false;
+        }
+      }
+      return true;
+    }
+
+    template <typename Function>
+    void forEach (Function function) const {
+      for (auto i = 0, end = words_.size (); i < end; ++i) {
+        auto word = words_[i];
+        while (word) {
+          function (i * 64 + int (qCountTrailingZeroBits (word)));
+          word &= word - 1;
+        }
+      }
+    }
+
+    bool operator== (const Bitset &other) const {
+      return size_ == other.size_ && words_ == other.words_;
+    }
+
+  private:
+    int size_;
+    QVector<quint64> words_;
+};
@@ -0,0 +1,35 @@
+#include "filesizecache.h"
+
+#include <QFile>
+
+FileSize FileSizeCache::size (const QString &fileName) {
+  {
+    QReadLocker locker (&lock_);
+    const auto it = sizes_.constFind (fileName);
+    if (it != sizes_.cend ()) {
+      return it.value ();
+    }
+  }
+
+  FileSize result;
+  QFile file (fileName);
+  if (file.open (QFile::ReadOnly)) {
+    const auto source = file.readAll ();
+    result.bytes = uint (source.size ());
+    result.lines = uint (source.count ('\n'));
+  }
+
+  QWriteLocker locker (&lock_);
+  sizes_.insert (fileName, result);
+  return result;
+}
+
+void FileSizeCache::invalidate (const QString &fileName) {
+  QWriteLocker locker (&lock_);
+  sizes_.remove (fileName);
+}
+
+void FileSizeCache::clear () {
+  QWriteLocker locker (&lock_);
+  sizes_.clear ();
+}
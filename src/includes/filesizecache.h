@@ -0,0 +1,22 @@
+#pragma once
+
+#include <QHash>
+#include <QReadWriteLock>
+
+struct FileSize {
+  uint bytes = 0u;
+  uint lines = 0u;
+};
+
+// Sizes of files on disk, read once and kept until invalidated.
+// All methods are thread safe.
+class FileSizeCache {
+  public:
+    FileSize size (const QString &fileName);
+    void invalidate (const QString &fileName);
+    void clear ();
+
+  private:
+    mutable QReadWriteLock lock_;
+    QHash<QString, FileSize> sizes_;
+};
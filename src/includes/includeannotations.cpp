@@ -0,0 +1,120 @@
+#include "includeannotations.h"
+#include "includegraph.h"
+
+#include <coreplugin/editormanager/documentmodel.h>
+#include <coreplugin/editormanager/editormanager.h>
+
+#include <cpptools/cppmodelmanager.h>
+
+#include <texteditor/textmark.h>
+
+#include <utils/runextensions.h>
+#include <utils/theme/theme.h>
+
+#include <QFutureWatcher>
+
+using namespace CPlusPlus;
+
+namespace {
+  const char MARK_CATEGORY[] = "IncludeUtils.Weight";
+  const auto heavyWeight = 1024u * 1024u;
+  const auto mediumWeight = 256u * 1024u;
+
+  struct IncludeCost {
+    int line;
+    uint own;
+    uint unique;
+  };
+
+  QVector<IncludeCost> includeCosts (const Snapshot &snapshot, const Document::Ptr &document,
+                                     QSharedPointer<IncludeGraph> graph) {
+    QVector<IncludeCost> result;
+    for (const auto &include: document->resolvedIncludes ()) {
+      const auto fileName = include.resolvedFileName ();
+      if (include.line () < 1 || fileName.isEmpty ()) {
+        continue;
+      }
+      graph->expand (fileName, snapshot);
+      result.append ({include.line (), graph->ownWeight (fileName), graph->weight (fileName)});
+      graph->dependents (fileName); // cached for hover
+    }
+    return result;
+  }
+}
+
+namespace QtcUtilities {
+  namespace Internal {
+    namespace IncludeUtils {
+
+      IncludeAnnotations::IncludeAnnotations (QSharedPointer<IncludeGraph> graph, QObject *parent) :
+        QObject (parent),
+        graph_ (graph) {
+        connect (CppTools::CppModelManager::instance (), &CppTools::CppModelManager::documentUpdated,
+                 this, &IncludeAnnotations::update);
+        connect (Core::EditorManager::instance (), &Core::EditorManager::documentClosed,
+                 this, [this](Core::IDocument *document) {
+          clear (document->filePath ().toString ());
+        });
+      }
+
+      IncludeAnnotations::~IncludeAnnotations () {
+        for (const auto &marks: marks_) {
+          qDeleteAll (marks);
+        }
+      }
+
+      void IncludeAnnotations::update (const Document::Ptr &document) {
+        if (!document) {
+          return;
+        }
+        const auto fileName = document->fileName ();
+        if (!Core::DocumentModel::documentForFilePath (Utils::FilePath::fromString (fileName))) {
+          return;
+        }
+        const auto revision = document->revision ();
+        if (revisions_.contains (fileName) && revisions_.value (fileName) == revision) {
+          return;
+        }
+        revisions_[fileName] = revision;
+
+        auto future = Utils::runAsync (includeCosts, CppTools::CppModelManager::instance ()->snapshot (),
+                                       document, graph_);
+        auto watcher = new QFutureWatcher<QVector<IncludeCost> >(this);
+        connect (watcher, &QFutureWatcherBase::finished,
+                 this, [this, watcher, fileName, revision] {
+          watcher->deleteLater ();
+          if (watcher->future ().resultCount () == 0 || revisions_.value (fileName) != revision) {
+            return;
+          }
+
+          auto &marks = marks_[fileName];
+          qDeleteAll (marks);
+          marks.clear ();
+          const auto filePath = Utils::FilePath::fromString (fileName);
+          for (const auto &cost: watcher->result ()) {
+            const auto text = QString::number (cost.own / 1024., 'f', 1) + " ("
+                              + QString::number (cost.unique / 1024., 'f', 1) + ") Kb";
+            auto mark = new TextEditor::TextMark (filePath, cost.line, MARK_CATEGORY);
+            mark->setLineAnnotation (text);
+            mark->setToolTip (tr ("Own (with includes) size: %1").arg (text));
+            mark->setPriority (TextEditor::TextMark::LowPriority);
+            if (cost.unique >= heavyWeight) {
+              mark->setColor (Utils::Theme::CodeModel_Error_TextMarkColor);
+            }
+            else if (cost.unique >= mediumWeight) {
+              mark->setColor (Utils::Theme::CodeModel_Warning_TextMarkColor);
+            }
+            marks.append (mark);
+          }
+        });
+        watcher->setFuture (future);
+      }
+
+      void IncludeAnnotations::clear (const QString &fileName) {
+        revisions_.remove (fileName);
+        qDeleteAll (marks_.take (fileName));
+      }
+
+    } // namespace IncludeUtils
+  } // namespace Internal
+} // namespace QtcUtilities
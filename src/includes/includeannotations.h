@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cplusplus/CppDocument.h>
+
+#include <QObject>
+#include <QSharedPointer>
+
+class IncludeGraph;
+
+namespace TextEditor {
+  class TextMark;
+}
+
+namespace QtcUtilities {
+  namespace Internal {
+    namespace IncludeUtils {
+
+      // Shows own and transitive weight at every include of opened documents.
+      class IncludeAnnotations : public QObject {
+        Q_OBJECT
+
+        public:
+          IncludeAnnotations (QSharedPointer<IncludeGraph> graph, QObject *parent);
+          ~IncludeAnnotations () override;
+
+        private:
+          void update (const CPlusPlus::Document::Ptr &document);
+          void clear (const QString &fileName);
+
+          QSharedPointer<IncludeGraph> graph_;
+          QHash<QString, unsigned> revisions_;
+          QHash<QString, QVector<TextEditor::TextMark *> > marks_;
+      };
+
+    } // namespace IncludeUtils
+  } // namespace Internal
+} // namespace QtcUtilities
@@ -0,0 +1,178 @@
+#include "includebatch.h"
+#include "includegraph.h"
+#include "includemodifier.h"
+#include "includeorganizer.h"
+#include "includetree.h"
+
+#include <QDir>
+#include <QFile>
+#include <QSet>
+
+#include <algorithm>
+
+using namespace CPlusPlus;
+
+namespace {
+  const auto diffContext = 3;
+
+  bool read (const CppTools::WorkingCopy &workingCopy, const QString &fileName,
+             QByteArray &contents) {
+    if (workingCopy.contains (fileName)) {
+      contents = workingCopy.source (fileName);
+      return true;
+    }
+    QFile file (fileName);
+    if (!file.open (QFile::ReadOnly)) {
+      return false;
+    }
+    contents = file.readAll ();
+    return true;
+  }
+
+  QStringList splitLines (const QByteArray &contents) {
+    auto lines = QString::fromUtf8 (contents).split (QLatin1Char ('\n'));
+    if (!lines.isEmpty () && lines.last ().isEmpty ()) {
+      lines.removeLast ();
+    }
+    return lines;
+  }
+}
+
+BatchOrganizer::BatchOrganizer (const Snapshot &snapshot, const CppTools::WorkingCopy &workingCopy,
+                                QSharedPointer<IncludeGraph> graph,
+                                QSharedPointer<LookupCache> lookups) :
+  snapshot_ (snapshot),
+  workingCopy_ (workingCopy),
+  graph_ (graph),
+  lookups_ (lookups) {
+
+}
+
+BatchFileResult BatchOrganizer::operator() (const QString &fileName) const {
+  BatchFileResult result;
+  result.fileName = fileName;
+
+  QByteArray contents;
+  if (!read (workingCopy_, fileName, contents)) {
+    return result;
+  }
+
+  const auto organized = analyzeIncludes (snapshot_, contents, fileName, *graph_,
+                                          lookups_.data ());
+  if (!organized.tree) {
+    return result;
+  }
+
+  result.lines = splitLines (contents);
+
+  IncludeModifier modifier (organized.document, result.lines);
+  modifier.queueDuplicatesRemoval ();
+  modifier.queueUpdates (*organized.tree);
+  result.removedLines = modifier.queuedLines ();
+
+  const auto kept = organized.tree->includes ();
+  QSet<QString> was;
+  for (const auto &include: organized.document->resolvedIncludes ()) {
+    if (include.line () < 1) {
+      continue;
+    }
+    was.insert (include.resolvedFileName ());
+    if (!kept.contains (include.resolvedFileName ())) {
+      result.removedIncludes.append (include.unresolvedFileName ());
+    }
+  }
+  result.savedWeight = organized.tree->totalWeight (was).unique
+                       - organized.tree->totalWeight (QSet<QString> (kept.cbegin (), kept.cend ())).unique;
+
+  return result;
+}
+
+BatchSorter::BatchSorter (const Snapshot &snapshot, const CppTools::WorkingCopy &workingCopy,
+                          const IncludeSorter &sorter) :
+  snapshot_ (snapshot),
+  workingCopy_ (workingCopy),
+  sorter_ (sorter) {
+
+}
+
+BatchFileResult BatchSorter::operator() (const QString &fileName) const {
+  BatchFileResult result;
+  result.fileName = fileName;
+
+  QByteArray contents;
+  if (!read (workingCopy_, fileName, contents)) {
+    return result;
+  }
+  result.lines = splitLines (contents);
+
+  auto document = snapshot_.document (fileName);
+  if (!document) {
+    document = Document::create (fileName);
+  }
+  IncludeModifier modifier (document, result.lines);
+  modifier.queueSorting (sorter_);
+  result.removedLines = modifier.queuedLines ();
+  result.insertedLines = modifier.queuedInsertions ();
+  return result;
+}
+
+QString unifiedDiff (const BatchFileResult &result, const QDir &base) {
+  const auto &removed = result.removedLines;
+  const auto &inserted = result.insertedLines;
+  const auto &lines = result.lines;
+  if (removed.isEmpty () && inserted.isEmpty ()) {
+    return {};
+  }
+
+  auto changed = removed;
+  changed += inserted.keys ().toVector ();
+  std::sort (changed.begin (), changed.end ());
+  changed.erase (std::unique (changed.begin (), changed.end ()), changed.end ());
+  const auto isRemoved = QSet<int> (removed.cbegin (), removed.cend ());
+
+  const auto name = base.relativeFilePath (result.fileName);
+  auto diff = QString ("--- a/%1\n+++ b/%1\n").arg (name);
+
+  auto shift = 0; // added minus removed lines in previous hunks
+  for (auto first = 0; first < changed.size ();) {
+    auto last = first;
+    while (last + 1 < changed.size () && changed[last + 1] - changed[last] <= 2 * diffContext) {
+      ++last;
+    }
+
+    const auto begin = std::max (0, changed[first] - diffContext);
+    const auto end = std::min (lines.size (), changed[last] + diffContext + 1);
+    QString hunk;
+    auto oldCount = 0;
+    auto newCount = 0;
+    for (auto line = begin; line <= end; ++line) {
+      if (line < end || end == lines.size ()) {
+        for (const auto &text: inserted.value (line)) {
+          hunk += QLatin1Char ('+') + text + QLatin1Char ('\n');
+          ++newCount;
+        }
+      }
+      if (line == end) {
+        break;
+      }
+      if (isRemoved.contains (line)) {
+        hunk += QLatin1Char ('-') + lines[line] + QLatin1Char ('\n');
+      }
+      else {
+        hunk += QLatin1Char (' ') + lines[line] + QLatin1Char ('\n');
+        ++newCount;
+      }
+      ++oldCount;
+    }
+
+    diff += QString ("@@ -%1,%2 +%3,%4 @@\n")
+            .arg (begin + 1).arg (oldCount)
+            .arg (begin + 1 + shift).arg (newCount);
+    diff += hunk;
+
+    shift += newCount - oldCount;
+    first = last + 1;
+  }
+
+  return diff;
+}
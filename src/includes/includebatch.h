@@ -0,0 +1,59 @@
+#pragma once
+
+#include "includesorter.h"
+
+#include <cplusplus/CppDocument.h>
+#include <cpptools/cppworkingcopy.h>
+
+#include <QMap>
+#include <QSharedPointer>
+
+class IncludeGraph;
+class LookupCache;
+class QDir;
+
+struct BatchFileResult {
+  QString fileName;
+  QStringList lines;
+  QVector<int> removedLines;
+  QMap<int, QStringList> insertedLines; // line to insert before -> lines
+  QStringList removedIncludes;
+  quint64 savedWeight = 0u;
+};
+
+// Organizes includes of a single file without opening it in an editor.
+// Copies share snapshot, include graph and lookup cache, so it is used as a mapped functor.
+class BatchOrganizer {
+  public:
+    using result_type = BatchFileResult;
+
+    BatchOrganizer (const CPlusPlus::Snapshot &snapshot, const CppTools::WorkingCopy &workingCopy,
+                    QSharedPointer<IncludeGraph> graph, QSharedPointer<LookupCache> lookups);
+
+    BatchFileResult operator() (const QString &fileName) const;
+
+  private:
+    CPlusPlus::Snapshot snapshot_;
+    CppTools::WorkingCopy workingCopy_;
+    QSharedPointer<IncludeGraph> graph_;
+    QSharedPointer<LookupCache> lookups_;
+};
+
+// Sorts includes of a single file without opening it in an editor.
+class BatchSorter {
+  public:
+    using result_type = BatchFileResult;
+
+    BatchSorter (const CPlusPlus::Snapshot &snapshot, const CppTools::WorkingCopy &workingCopy,
+                 const IncludeSorter &sorter);
+
+    BatchFileResult operator() (const QString &fileName) const;
+
+  private:
+    CPlusPlus::Snapshot snapshot_;
+    CppTools::WorkingCopy workingCopy_;
+    IncludeSorter sorter_;
+};
+
+// Unified diff of removed and inserted lines, with paths relative to base.
+QString unifiedDiff (const BatchFileResult &result, const QDir &base);
@@ -0,0 +1,120 @@
+#include "includecycles.h"
+#include "includegraph.h"
+#include "includetrace.h"
+
+#include <algorithm>
+
+namespace {
+  IncludeCycle makeCycle (const IncludeSubgraph &graph, const QVector<int> &nodes,
+                          const QVector<int> &components) {
+    IncludeCycle result;
+    const auto component = components[nodes.first ()];
+    auto edges = 0;
+    auto cheapest = -1;
+    auto cheapestFrom = -1;
+    for (const auto node: nodes) {
+      result.files.append (graph.paths[node]);
+      result.weight += graph.ownWeights[node];
+      for (auto edge = graph.offsets[node], end = graph.offsets[node + 1]; edge < end; ++edge) {
+        const auto target = graph.edges[edge];
+        if (components[target] != component) {
+          continue;
+        }
+        ++edges;
+        if (cheapest == -1 || graph.ownWeights[target] < graph.ownWeights[cheapest]) {
+          cheapest = target;
+          cheapestFrom = node;
+        }
+      }
+    }
+
+    result.from = graph.paths[cheapestFrom];
+    result.to = graph.paths[cheapest];
+    result.edgeWeight = graph.ownWeights[cheapest];
+    // strongly connected with as many edges as nodes is a simple cycle
+    result.isBroken = edges == nodes.size ();
+    return result;
+  }
+}
+
+QVector<IncludeCycle> findIncludeCycles (const IncludeSubgraph &graph) {
+  INCLUDES_TRACE_SCOPE ("findIncludeCycles");
+  struct Frame {
+    int node;
+    int edge;
+  };
+
+  const auto size = graph.size ();
+  QVector<int> index (size, -1);
+  QVector<int> low (size);
+  QVector<int> components (size, -1);
+  QVector<int> stack;
+  QVector<Frame> calls;
+  auto counter = 0;
+  auto componentCount = 0;
+  QVector<IncludeCycle> result;
+
+  const auto visit = [&](int node) {
+                       index[node] = low[node] = counter++;
+                       stack.append (node);
+                       calls.append ({node, graph.offsets[node]});
+                     };
+
+  for (auto root = 0; root < size; ++root) {
+    if (index[root] != -1) {
+      continue;
+    }
+    visit (root);
+    while (!calls.isEmpty ()) {
+      auto &frame = calls.last ();
+      if (frame.edge < graph.offsets[frame.node + 1]) {
+        const auto next = graph.edges[frame.edge++];
+        if (index[next] == -1) {
+          visit (next);
+        }
+        else if (components[next] == -1) { // still on stack
+          low[frame.node] = std::min (low[frame.node], index[next]);
+        }
+        continue;
+      }
+
+      const auto node = frame.node;
+      calls.removeLast ();
+      if (!calls.isEmpty ()) {
+        auto &parent = low[calls.last ().node];
+        parent = std::min (parent, low[node]);
+      }
+      if (low[node] != index[node]) {
+        continue;
+      }
+
+      QVector<int> nodes;
+      auto member = -1;
+      do {
+        member = stack.takeLast ();
+        components[member] = componentCount;
+        nodes.append (member);
+      } while (member != node);
+      ++componentCount;
+      if (nodes.size () > 1) {
+        result.append (makeCycle (graph, nodes, components));
+      }
+    }
+  }
+
+  std::sort (result.begin (), result.end (), [](const IncludeCycle &l, const IncludeCycle &r) {
+    return l.weight > r.weight;
+  });
+  return result;
+}
+
+QVector<IncludeCycle> includeCycles (const CPlusPlus::Snapshot &snapshot, const QStringList &files,
+                                     QSharedPointer<IncludeGraph> graph) {
+  graph->expand (files, snapshot);
+  QVector<int> roots;
+  roots.reserve (files.size ());
+  for (const auto &file: files) {
+    roots.append (graph->id (file));
+  }
+  return findIncludeCycles (graph->subgraph (roots));
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <QSharedPointer>
+#include <QStringList>
+
+namespace CPlusPlus {
+  class Snapshot;
+}
+
+class IncludeGraph;
+struct IncludeSubgraph;
+
+// Files including each other, a strongly connected component of the graph.
+struct IncludeCycle {
+  QStringList files;
+  quint64 weight = 0u;  // own sizes of all files
+  QString from;         // cheapest include to remove: from includes to
+  QString to;
+  uint edgeWeight = 0u; // own size of to
+  bool isBroken = false; // removing the include alone breaks the cycle
+};
+
+// Cycles of the graph, heaviest first. Iterative Tarjan, linear in graph size.
+QVector<IncludeCycle> findIncludeCycles (const IncludeSubgraph &graph);
+
+// Expands the graph from files and finds cycles among everything reachable.
+QVector<IncludeCycle> includeCycles (const CPlusPlus::Snapshot &snapshot, const QStringList &files,
+                                     QSharedPointer<IncludeGraph> graph);
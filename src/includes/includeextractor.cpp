@@ -1,4 +1,6 @@
 #include "includeextractor.h"
+#include "lookupcache.h"
+#include "includetrace.h"
 
 #include <extensionsystem/pluginmanager.h>
 
@@ -6,6 +8,9 @@
 
 #include <utils/qtcassert.h>
 
+#include <QtConcurrent>
+#include <QThread>
+
 using namespace CPlusPlus;
 
 static bool hasNonForwardDeclaration (const QList<LookupItem> &matches) {
@@ -16,13 +21,56 @@ static bool hasNonForwardDeclaration (const QList<LookupItem> &matches) {
   return ok;
 }
 
+namespace {
+  // smaller documents are not worth creating bindings for every part
+  const auto minParallelTokens = 20000;
+
+  void collectDeclarations (DeclarationListAST *list, QVector<DeclarationAST *> &declarations) {
+    for (auto it = list; it; it = it->next) {
+      const auto declaration = it->value;
+      if (!declaration) {
+        continue;
+      }
+      const auto ns = declaration->asNamespace ();
+      const auto body = ns && ns->linkage_body ? ns->linkage_body->asLinkageBody () : nullptr;
+      if (body) {
+        collectDeclarations (body->declaration_list, declarations);
+        continue;
+      }
+      declarations.append (declaration);
+    }
+  }
+}
+
+struct IncludeExtractor::Part {
+  struct Result {
+    QSet<QString> includes;
+    QSet<Symbol *> symbols;
+    QSet<QString> unresolved;
+    QSet<Symbol *> completeUses;
+  };
+  using result_type = Result;
+
+  const IncludeExtractor *parent;
+
+  result_type operator() (const Declarations &declarations) const {
+    INCLUDES_TRACE_SCOPE ("IncludeExtractor::Part");
+    IncludeExtractor extractor (parent->document_, parent->snapshot_, parent->cache_,
+                                parent->scopes_);
+    extractor.bindings_.reset (new CreateBindings (parent->document_, parent->snapshot_));
+    for (const auto declaration: declarations) {
+      extractor.accept (declaration);
+    }
+    return {extractor.includes_, extractor.symbols_, extractor.unresolved_,
+            extractor.completeUses_};
+  }
+};
+
 IncludeExtractor::IncludeExtractor (Document::Ptr document,
-                                    const Snapshot &snapshot) :
-  ASTVisitor (document ? document->translationUnit () : nullptr),
-  document_ (document),
-  snapshot_ (snapshot),
-  bindings_ (new CreateBindings (document, snapshot)) {
+                                    const Snapshot &snapshot, LookupCache *cache, Mode mode) :
+  IncludeExtractor (document, snapshot, cache, QSharedPointer<const ScopeIndex>::create (document)) {
   QTC_ASSERT (document, return );
+  INCLUDES_TRACE_SCOPE ("IncludeExtractor");
 
   //  bindings_->setExpandTemplates (true);
 
@@ -30,7 +78,62 @@ IncludeExtractor::IncludeExtractor (Document::Ptr document,
     return;
   }
 
-  accept (translationUnit ()->ast ());
+  const auto parts = mode == Mode::Parallel ? partition () : QVector<Declarations> ();
+  if (parts.size () < 2) {
+    bindings_.reset (new CreateBindings (document_, snapshot_));
+    accept (translationUnit ()->ast ());
+    return;
+  }
+
+  const auto results = QtConcurrent::blockingMapped<QVector<Part::result_type> >(parts, Part {this});
+  for (const auto &result: results) {
+    includes_ += result.includes;
+    symbols_ += result.symbols;
+    unresolved_ += result.unresolved;
+    completeUses_ += result.completeUses;
+  }
+}
+
+IncludeExtractor::IncludeExtractor (Document::Ptr document, const Snapshot &snapshot,
+                                    LookupCache *cache, QSharedPointer<const ScopeIndex> scopes) :
+  ASTVisitor (document ? document->translationUnit () : nullptr),
+  document_ (document),
+  snapshot_ (snapshot),
+  scopes_ (scopes),
+  cache_ (cache),
+  isIncompleteUse_ (false),
+  lookupDepth_ (0),
+  lookupCount_ (0) {
+
+}
+
+QVector<IncludeExtractor::Declarations> IncludeExtractor::partition () const {
+  const auto threads = QThread::idealThreadCount ();
+  const auto ast = translationUnit ()->ast ()->asTranslationUnit ();
+  if (threads < 2 || !ast || int (translationUnit ()->tokenCount ()) < minParallelTokens) {
+    return {};
+  }
+
+  Declarations declarations;
+  collectDeclarations (ast->declaration_list, declarations);
+
+  auto tokens = 0;
+  for (const auto declaration: declarations) {
+    tokens += int (declaration->lastToken () - declaration->firstToken ());
+  }
+  const auto tokensPerPart = tokens / threads + 1;
+
+  QVector<Declarations> result (1);
+  auto partTokens = 0;
+  for (const auto declaration: declarations) {
+    if (partTokens >= tokensPerPart) {
+      result.append ({});
+      partTokens = 0;
+    }
+    result.last ().append (declaration);
+    partTokens += int (declaration->lastToken () - declaration->firstToken ());
+  }
+  return result;
 }
 
 bool IncludeExtractor::visit (NamedTypeSpecifierAST *ast) {
@@ -39,10 +142,12 @@ bool IncludeExtractor::visit (NamedTypeSpecifierAST *ast) {
     return true;
   }
   const auto name = Overview () (ast->name->name);
-  qCritical () << "NamedTypeSpecifierAST" << name;
+  INCLUDES_TRACE << "NamedTypeSpecifierAST" << name;
   const auto scope = scopeAtToken (ast->firstToken ());
   QTC_ASSERT (scope, return true);
-  addExpression (name, scope);
+  isIncompleteUse_ = incompleteSpecifiers_.contains (ast);
+  addExpression (name, scope, true);
+  isIncompleteUse_ = false;
   return true;
 }
 
@@ -52,7 +157,7 @@ bool IncludeExtractor::visit (DeclaratorIdAST *ast) {
     return true;
   }
   const auto name = Overview () (ast->name->name);
-  qCritical () << "DeclaratorIdAST" << name;
+  INCLUDES_TRACE << "DeclaratorIdAST" << name;
   const auto scope = scopeAtToken (ast->firstToken ());
   QTC_ASSERT (scope, return true);
   addExpression (name, scope);
@@ -65,24 +170,24 @@ bool IncludeExtractor::visit (IdExpressionAST *ast) {
     return true;
   }
   const auto name = Overview () (ast->name->name);
-  qCritical () << "IdExpressionAST" << name;
+  INCLUDES_TRACE << "IdExpressionAST" << name;
   const auto scope = scopeAtToken (ast->firstToken ());
   QTC_ASSERT (scope, return true);
-  addExpression (name, scope);
+  addExpression (name, scope, true);
   return true;
 }
 
 bool IncludeExtractor::visit (CallAST *ast) {
   QTC_ASSERT (ast, return false);
-  qCritical () << "CallAST";
+  INCLUDES_TRACE << "CallAST";
   const auto scope = scopeAtToken (ast->firstToken ());
   QTC_ASSERT (scope, return true);
   QTC_ASSERT (ast->base_expression, return true);
-  addExpression (ast->base_expression, scope);
+  addExpression (ast->base_expression, scope, true);
 
   auto expression = ast->expression_list;
   while (expression) {
-    qCritical () << "CallAST expression_list";
+    INCLUDES_TRACE << "CallAST expression_list";
     addExpression (expression->value, scope);
     expression = expression->next;
   }
@@ -96,7 +201,7 @@ bool IncludeExtractor::visit (TemplateIdAST *ast) {
     return true;
   }
   const auto name = Overview () (ast->name);
-  qCritical () << "TemplateIdAST" << name;
+  INCLUDES_TRACE << "TemplateIdAST" << name;
   const auto scope = scopeAtToken (ast->firstToken ());
   QTC_ASSERT (scope, return true);
   addExpression (name, scope);
@@ -109,7 +214,7 @@ bool IncludeExtractor::visit (UsingDirectiveAST *ast) {
     return true;
   }
   const auto name = Overview () (ast->name->name);
-  qCritical () << "UsingDirectiveAST" << name;
+  INCLUDES_TRACE << "UsingDirectiveAST" << name;
   const auto scope = scopeAtToken (ast->firstToken ());
   QTC_ASSERT (scope, return true);
   addExpression (name, scope);
@@ -122,48 +227,94 @@ bool IncludeExtractor::visit (MemberAccessAST *ast) {
     return true;
   }
   const auto name = Overview () (ast->member_name->name);
-  qCritical () << "MemberAccessAST" << name;
+  INCLUDES_TRACE << "MemberAccessAST" << name;
   const auto scope = scopeAtToken (ast->firstToken ());
   QTC_ASSERT (scope, return true);
   addExpression (name, scope);
   return true;
 }
 
+bool IncludeExtractor::visit (SimpleDeclarationAST *ast) {
+  QTC_ASSERT (ast, return false);
+  QVector<DeclaratorAST *> declarators;
+  for (auto it = ast->declarator_list; it; it = it->next) {
+    declarators.append (it->value);
+  }
+  markIncompleteUses (ast->decl_specifier_list, declarators);
+  return true;
+}
+
+bool IncludeExtractor::visit (ParameterDeclarationAST *ast) {
+  QTC_ASSERT (ast, return false);
+  markIncompleteUses (ast->type_specifier_list, {ast->declarator});
+  return true;
+}
+
+bool IncludeExtractor::visit (FunctionDefinitionAST *ast) {
+  QTC_ASSERT (ast, return false);
+  markIncompleteUses (ast->decl_specifier_list, {ast->declarator});
+  return true;
+}
+
 Scope *IncludeExtractor::scopeAtToken (unsigned token) const {
   QTC_ASSERT (translationUnit (), return nullptr);
   int line = 0;
   int column = 0;
   translationUnit ()->getTokenStartPosition (token, &line, &column);
-  return document_->scopeAt (line);
+  return scopes_->scopeAt (line);
 }
 
-void IncludeExtractor::addExpression (const QString &name, CPlusPlus::Scope *scope) {
+void IncludeExtractor::addExpression (const QString &name, CPlusPlus::Scope *scope,
+                                      bool isWritten) {
   if (name.isEmpty ()) {
     return;
   }
   QTC_ASSERT (scope, return );
 
+  ++lookupCount_;
   const auto pair = qMakePair (name, scope);
-  if (checkedTypes_.contains (pair)) {
+  auto &checked = isIncompleteUse_ ? checkedIncompleteTypes_ : checkedTypes_;
+  if (checked.contains (pair)) {
     return;
   }
-  checkedTypes_.insert (pair);
-  qCritical () << "add string expression" << name;
+  checked.insert (pair);
+  INCLUDES_TRACE << "add string expression" << name;
 
+  const auto fileName = document_->fileName ();
+  LookupCache::Entry lookup;
+  const auto isCached = cache_ && cache_->find (fileName, name, scope, lookup);
   TypeOfExpression toe;
-  toe.init (document_, snapshot_, bindings_);
-  const auto matches = toe (name.toUtf8 (), scope);
+  if (!isCached) {
+    toe.init (document_, snapshot_, bindings_);
+    lookup.matches = toe (name.toUtf8 (), scope);
+  }
 
-  addDeclarations (matches);
+  // names as written only, members and spelled types resolve elsewhere
+  if (lookup.matches.isEmpty () && isWritten && lookupDepth_ == 0) {
+    unresolved_.insert (name);
+  }
+  addDeclarations (lookup.matches);
+  if (isCached) {
+    return;
+  }
 
+  // lookups in expression use scopes of this document, so they can not be cached
+  const auto lookupCount = lookupCount_;
   if (toe.ast ()) {
+    ++lookupDepth_;
     accept (toe.ast ());
+    --lookupDepth_;
+  }
+  if (cache_ && lookupCount == lookupCount_ && isCacheable (scope, lookup.matches)) {
+    lookup.bindings = bindings_;
+    cache_->insert (fileName, name, scope, lookup);
   }
 }
 
-void IncludeExtractor::addExpression (ExpressionAST *ast, Scope *scope) {
+void IncludeExtractor::addExpression (ExpressionAST *ast, Scope *scope, bool isCallee) {
   QTC_ASSERT (scope, return );
   QTC_ASSERT (ast, return );
+#ifdef INCLUDES_TRACING
   QString callName;
   if (auto e = ast->asIdExpression ()) {
     callName = Overview () (e->name->name);
@@ -171,16 +322,24 @@ void IncludeExtractor::addExpression (ExpressionAST *ast, Scope *scope) {
   else if (auto e = ast->asMemberAccess ()) {
     callName = Overview () (e->member_name->name);
   }
-  qCritical () << "add ast expression" << callName;
+  INCLUDES_TRACE << "add ast expression" << callName;
+#endif
+  ++lookupCount_;
 
   TypeOfExpression toe;
   toe.init (document_, snapshot_, bindings_);
   const auto matches = toe (ast, document_, scope);
 
+  const auto id = isCallee ? ast->asIdExpression () : nullptr;
+  if (matches.isEmpty () && id && id->name && id->name->name && lookupDepth_ == 0) {
+    unresolved_.insert (Overview () (id->name->name));
+  }
   addDeclarations (matches);
 
   if (toe.ast ()) {
+    ++lookupDepth_;
     accept (toe.ast ());
+    --lookupDepth_;
   }
 }
 
@@ -212,12 +371,50 @@ bool IncludeExtractor::addDeclaration (Symbol *declaration) {
   const auto fileName = QString::fromUtf8 (declaration->fileName ());
   includes_.insert (fileName);
   symbols_.insert (declaration);
+  if (!isIncompleteUse_) {
+    completeUses_.insert (declaration);
+  }
+
+  INCLUDES_TRACE << ">>>addDeclaration"
+                 << "at" << fileName
+                 << declaration
+                 << typeid (*declaration).name ()
+                 << Overview () (declaration->type ().type ());
 
-  qCritical () << ">>>addDeclaration"
-               << "at" << fileName
-               << declaration
-               << typeid (*declaration).name ()
-               << Overview () (declaration->type ().type ());
+  return true;
+}
 
+bool IncludeExtractor::isCacheable (Scope *scope, const QList<LookupItem> &matches) const {
+  // current document's symbols are replaced on every parse
+  const auto fileId = translationUnit ()->fileId ();
+  if (scope->fileId () == fileId) {
+    return false;
+  }
+  for (const auto &match: matches) {
+    if ((match.declaration () && match.declaration ()->fileId () == fileId)
+        || (match.scope () && match.scope ()->fileId () == fileId)) {
+      return false;
+    }
+  }
   return true;
 }
+
+void IncludeExtractor::markIncompleteUses (SpecifierListAST *specifiers,
+                                           const QVector<DeclaratorAST *> &declarators) {
+  // type of pointers and references only, e.g. 'Type *a, &b'
+  if (declarators.isEmpty ()) {
+    return;
+  }
+  for (const auto declarator: declarators) {
+    const auto ptr = declarator && declarator->ptr_operator_list
+                     ? declarator->ptr_operator_list->value : nullptr;
+    if (!ptr || (!ptr->asPointer () && !ptr->asReference ())) {
+      return;
+    }
+  }
+  for (auto it = specifiers; it; it = it->next) {
+    if (const auto named = it->value ? it->value->asNamedTypeSpecifier () : nullptr) {
+      incompleteSpecifiers_.insert (named);
+    }
+  }
+}
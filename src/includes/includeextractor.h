@@ -5,12 +5,23 @@
 
 #include <cplusplus/CppDocument.h>
 
-#include <QDebug>
+#include "includetrace.h"
+#include "scopeindex.h"
 
+class LookupCache;
+
+// Collects symbols used by document and files, declaring them.
+// Parallel mode splits large documents by top level declarations and
+// extracts each part on the thread pool with its own bindings.
 class IncludeExtractor : public CPlusPlus::ASTVisitor {
   public:
+    enum class Mode {
+      Sequential, Parallel
+    };
+
     IncludeExtractor (CPlusPlus::Document::Ptr document,
-                      const CPlusPlus::Snapshot &snapshot);
+                      const CPlusPlus::Snapshot &snapshot, LookupCache *cache = nullptr,
+                      Mode mode = Mode::Sequential);
 
     bool visit (CPlusPlus::NamedTypeSpecifierAST *) override;
     bool visit (CPlusPlus::DeclaratorIdAST *) override;
@@ -19,6 +30,9 @@ class IncludeExtractor : public CPlusPlus::ASTVisitor {
     bool visit (CPlusPlus::TemplateIdAST *) override;
     bool visit (CPlusPlus::UsingDirectiveAST *) override;
     bool visit (CPlusPlus::MemberAccessAST *) override;
+    bool visit (CPlusPlus::SimpleDeclarationAST *) override;
+    bool visit (CPlusPlus::ParameterDeclarationAST *) override;
+    bool visit (CPlusPlus::FunctionDefinitionAST *) override;
 
     const QSet<QString> &includes () const {
       return includes_;
@@ -26,28 +40,57 @@ class IncludeExtractor : public CPlusPlus::ASTVisitor {
     const QSet<CPlusPlus::Symbol *> &symbols () const {
       return symbols_;
     }
+    // symbols used not only by pointer or reference
+    const QSet<CPlusPlus::Symbol *> &completeUses () const {
+      return completeUses_;
+    }
+    // names without any declaration found
+    const QSet<QString> &unresolved () const {
+      return unresolved_;
+    }
 
   private:
+    using Declarations = QVector<CPlusPlus::DeclarationAST *>;
+    struct Part;
+
+    IncludeExtractor (CPlusPlus::Document::Ptr document, const CPlusPlus::Snapshot &snapshot,
+                      LookupCache *cache, QSharedPointer<const ScopeIndex> scopes);
+
+    QVector<Declarations> partition () const;
     CPlusPlus::Scope *scopeAtToken (unsigned token) const;
-    void addExpression (const QString &name, CPlusPlus::Scope *scope);
-    void addExpression (CPlusPlus::ExpressionAST *ast, CPlusPlus::Scope *scope);
+    void addExpression (const QString &name, CPlusPlus::Scope *scope, bool isWritten = false);
+    void addExpression (CPlusPlus::ExpressionAST *ast, CPlusPlus::Scope *scope,
+                        bool isCallee = false);
     void addDeclarations (const QList<CPlusPlus::LookupItem> &declarations);
     bool addDeclaration (CPlusPlus::Symbol *declaration);
+    bool isCacheable (CPlusPlus::Scope *scope,
+                      const QList<CPlusPlus::LookupItem> &matches) const;
+    void markIncompleteUses (CPlusPlus::SpecifierListAST *specifiers,
+                             const QVector<CPlusPlus::DeclaratorAST *> &declarators);
 
   private:
     CPlusPlus::Document::Ptr document_;
     const CPlusPlus::Snapshot &snapshot_;
+    QSharedPointer<const ScopeIndex> scopes_;
     QSharedPointer<CPlusPlus::CreateBindings> bindings_;
+    LookupCache *cache_;
     QSet<QPair<QString, CPlusPlus::Scope *> > checkedTypes_;
+    QSet<QPair<QString, CPlusPlus::Scope *> > checkedIncompleteTypes_;
+    QSet<CPlusPlus::NamedTypeSpecifierAST *> incompleteSpecifiers_;
+    bool isIncompleteUse_;
+    int lookupDepth_; // inside ASTs of lookups, not written in document
+    int lookupCount_; // started ones, to find lookups with nested ones
+    QSet<CPlusPlus::Symbol *> completeUses_;
     QSet<QString> includes_;
     QSet<CPlusPlus::Symbol *> symbols_;
+    QSet<QString> unresolved_;
 
-#ifdef QT_DEBUG
+#ifdef INCLUDES_TRACING
     QString indent;
 
   public:
     bool preVisit (CPlusPlus::AST *a) override {
-      qDebug () << qPrintable (indent) << "preVisit" << a << typeid(*a).name ();
+      INCLUDES_TRACE << qPrintable (indent) << "preVisit" << a << typeid(*a).name ();
       indent += QStringLiteral (" ");
       return true;
     }
@@ -0,0 +1,72 @@
+#include "includefanout.h"
+#include "includegraph.h"
+#include "includetrace.h"
+
+#include <algorithm>
+
+void countIncludingUnits (const IncludeSubgraph &graph, QVector<int> &units,
+                          QVector<quint64> &recompiled) {
+  INCLUDES_TRACE_SCOPE ("countIncludingUnits");
+  const auto size = graph.size ();
+  units = QVector<int> (size);
+  recompiled = QVector<quint64> (size);
+
+  QVector<int> visited (size, -1); // last unit that reached node
+  QVector<int> closure;
+  for (auto unit = 0; unit < size; ++unit) {
+    if (!graph.isUnit[unit]) {
+      continue;
+    }
+
+    closure.clear ();
+    closure.append (unit);
+    visited[unit] = unit;
+    auto weight = quint64 (0);
+    for (auto i = 0; i < closure.size (); ++i) {
+      const auto node = closure[i];
+      weight += graph.ownWeights[node];
+      for (auto edge = graph.offsets[node], end = graph.offsets[node + 1]; edge < end; ++edge) {
+        const auto target = graph.edges[edge];
+        if (visited[target] != unit) {
+          visited[target] = unit;
+          closure.append (target);
+        }
+      }
+    }
+
+    for (const auto node: closure) {
+      ++units[node];
+      recompiled[node] += weight;
+    }
+  }
+}
+
+QVector<IncludeFanOut> findIncludeFanOut (const IncludeSubgraph &graph) {
+  QVector<int> units;
+  QVector<quint64> recompiled;
+  countIncludingUnits (graph, units, recompiled);
+
+  const auto size = graph.size ();
+  QVector<IncludeFanOut> result;
+  for (auto node = 0; node < size; ++node) {
+    if (graph.isUnit[node] || units[node] == 0) {
+      continue;
+    }
+    result.append ({graph.paths[node], units[node], recompiled[node], graph.ownWeights[node]});
+  }
+  std::sort (result.begin (), result.end (), [](const IncludeFanOut &l, const IncludeFanOut &r) {
+    return l.recompiled > r.recompiled;
+  });
+  return result;
+}
+
+QVector<IncludeFanOut> includeFanOut (const CPlusPlus::Snapshot &snapshot, const QStringList &files,
+                                      QSharedPointer<IncludeGraph> graph) {
+  graph->expand (files, snapshot);
+  QVector<int> roots;
+  roots.reserve (files.size ());
+  for (const auto &file: files) {
+    roots.append (graph->id (file));
+  }
+  return findIncludeFanOut (graph->subgraph (roots));
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <QSharedPointer>
+#include <QStringList>
+
+namespace CPlusPlus {
+  class Snapshot;
+}
+
+class IncludeGraph;
+struct IncludeSubgraph;
+
+// Cost of changing a header: translation units to rebuild and their size.
+struct IncludeFanOut {
+  QString fileName;
+  int units = 0;
+  quint64 recompiled = 0u;
+  uint ownWeight = 0u;
+};
+
+// Per node of graph: units including it transitively and their total weight.
+// Costs sum of unit closures, each unit is walked once.
+void countIncludingUnits (const IncludeSubgraph &graph, QVector<int> &units,
+                          QVector<quint64> &recompiled);
+
+// Fan-out of every header of the graph, most recompiled first.
+QVector<IncludeFanOut> findIncludeFanOut (const IncludeSubgraph &graph);
+
+// Expands the graph from files and finds fan-out of everything reachable.
+QVector<IncludeFanOut> includeFanOut (const CPlusPlus::Snapshot &snapshot, const QStringList &files,
+                                      QSharedPointer<IncludeGraph> graph);
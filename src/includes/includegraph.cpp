@@ -0,0 +1,350 @@
+#include "includegraph.h"
+#include "includetrace.h"
+
+#include <cpptools/projectfile.h>
+
+#include <QtConcurrent>
+
+using namespace CPlusPlus;
+
+int IncludeGraph::id (const QString &fileName) const {
+  QReadLocker locker (&lock_);
+  return ids_.value (fileName, -1);
+}
+
+QString IncludeGraph::fileName (int id) const {
+  QReadLocker locker (&lock_);
+  return paths_.value (id);
+}
+
+bool IncludeGraph::contains (const QString &fileName) const {
+  QReadLocker locker (&lock_);
+  const auto id = ids_.value (fileName, -1);
+  return id != -1 && entries_[id].isKnown;
+}
+
+uint IncludeGraph::ownWeight (const QString &fileName) const {
+  QReadLocker locker (&lock_);
+  const auto id = ids_.value (fileName, -1);
+  return id != -1 ? entries_[id].ownWeight : 0u;
+}
+
+uint IncludeGraph::weight (const QString &fileName) {
+  QWriteLocker locker (&lock_);
+  const auto id = ids_.value (fileName, -1);
+  if (id == -1) {
+    return 0u;
+  }
+  return weight (id);
+}
+
+QStringList IncludeGraph::includes (const QString &fileName) const {
+  QReadLocker locker (&lock_);
+  const auto id = ids_.value (fileName, -1);
+  if (id == -1) {
+    return {};
+  }
+  QStringList result;
+  result.reserve (entries_[id].includes.size ());
+  for (const auto include: entries_[id].includes) {
+    result.append (paths_[include]);
+  }
+  return result;
+}
+
+IncludeGraph::Dependents IncludeGraph::dependents (const QString &fileName) {
+  QWriteLocker locker (&lock_);
+  const auto id = ids_.value (fileName, -1);
+  if (id == -1) {
+    return {};
+  }
+  if (entries_[id].hasDependents) {
+    return entries_[id].dependents;
+  }
+
+  Dependents result;
+  QVector<bool> visited (paths_.size ());
+  QVector<int> queue {id};
+  visited[id] = true;
+  while (!queue.isEmpty ()) {
+    const auto current = queue.takeLast ();
+    if (entries_[current].isUnit) {
+      ++result.units;
+      result.recompiled += weight (current);
+    }
+    for (const auto dependent: dependents_[current]) {
+      if (!visited[dependent]) {
+        visited[dependent] = true;
+        queue.append (dependent);
+      }
+    }
+  }
+  entries_[id].dependents = result;
+  entries_[id].hasDependents = true;
+  return result;
+}
+
+bool IncludeGraph::cachedCosts (const QString &fileName, uint &weight,
+                                Dependents &dependents) const {
+  QReadLocker locker (&lock_);
+  const auto id = ids_.value (fileName, -1);
+  if (id == -1 || !entries_[id].isKnown || !entries_[id].hasWeight
+      || !entries_[id].hasDependents) {
+    return false;
+  }
+  weight = entries_[id].weight;
+  dependents = entries_[id].dependents;
+  return true;
+}
+
+IncludeSubgraph IncludeGraph::subgraph (const QVector<int> &roots) const {
+  QReadLocker locker (&lock_);
+  IncludeSubgraph result;
+  QHash<int, int> nodes;
+
+  const auto add = [&](int id) {
+                     const auto it = nodes.constFind (id);
+                     if (it != nodes.cend ()) {
+                       return it.value ();
+                     }
+                     const auto node = result.files.size ();
+                     nodes.insert (id, node);
+                     result.files.append (id);
+                     result.paths.append (paths_[id]);
+                     result.ownWeights.append (entries_[id].ownWeight);
+                     result.ownLines.append (entries_[id].ownLines);
+                     result.isUnit.append (entries_[id].isUnit);
+                     return node;
+                   };
+
+  for (const auto root: roots) {
+    add (root);
+  }
+
+  result.offsets.append (0);
+  for (auto node = 0; node < result.files.size (); ++node) {
+    for (const auto include: entries_[result.files[node]].includes) {
+      result.edges.append (add (include));
+    }
+    result.offsets.append (result.edges.size ());
+  }
+  return result;
+}
+
+void IncludeGraph::expand (const QString &fileName, const Snapshot &snapshot) {
+  expand (QStringList {fileName}, snapshot);
+}
+
+void IncludeGraph::expand (const QStringList &fileNames, const Snapshot &snapshot) {
+  INCLUDES_TRACE_SCOPE ("IncludeGraph::expand");
+  using File = QPair<QString, Document::Ptr>;
+  struct Reader {
+    using result_type = Read;
+    const IncludeGraph *graph;
+    result_type operator() (const File &file) const {
+      return graph->read (file.first, file.second);
+    }
+  };
+
+  QVector<int> level;
+  {
+    QWriteLocker locker (&lock_);
+    for (const auto &fileName: fileNames) {
+      level.append (intern (fileName));
+    }
+  }
+  QSet<int> visited (level.cbegin (), level.cend ());
+  level = QVector<int> (visited.cbegin (), visited.cend ());
+
+  while (!level.isEmpty ()) {
+    QVector<File> stale;
+    QVector<int> staleIds;
+    {
+      QReadLocker locker (&lock_);
+      for (const auto id: level) {
+        const auto &path = paths_.at (id);
+        const auto &entry = entries_.at (id);
+        const auto document = snapshot.document (path);
+        if (!entry.isKnown || (document && document->revision () != entry.revision)) {
+          stale.append ({path, document});
+          staleIds.append (id);
+        }
+      }
+    }
+
+    const auto reads = QtConcurrent::blockingMapped<QVector<Read> >(stale, Reader {this});
+
+    QVector<int> next;
+    QWriteLocker locker (&lock_);
+    for (auto i = 0, end = reads.size (); i < end; ++i) {
+      store (staleIds[i], reads[i]);
+    }
+    for (const auto id: level) {
+      for (const auto include: entries_[id].includes) {
+        if (!visited.contains (include)) {
+          visited.insert (include);
+          next.append (include);
+        }
+      }
+    }
+    level = next;
+  }
+}
+
+void IncludeGraph::update (const Document::Ptr &document) {
+  if (!document) {
+    return;
+  }
+  sizes_.invalidate (document->fileName ());
+  auto id = -1;
+  {
+    QReadLocker locker (&lock_);
+    id = ids_.value (document->fileName (), -1);
+    if (id == -1 || !entries_.at (id).isKnown
+        || entries_.at (id).revision == document->revision ()) {
+      return;
+    }
+  }
+  const auto entry = read (document->fileName (), document);
+  QWriteLocker locker (&lock_);
+  store (id, entry);
+}
+
+void IncludeGraph::remove (const QStringList &fileNames) {
+  QWriteLocker locker (&lock_);
+  for (const auto &fileName: fileNames) {
+    sizes_.invalidate (fileName);
+    const auto id = ids_.value (fileName, -1);
+    if (id == -1 || !entries_[id].isKnown) {
+      continue;
+    }
+    invalidate (id);
+    for (const auto include: entries_[id].includes) {
+      dependents_[include].removeAll (id);
+    }
+    const auto isUnit = entries_[id].isUnit; // depends only on file name
+    entries_[id] = {};
+    entries_[id].isUnit = isUnit;
+  }
+}
+
+void IncludeGraph::clear () {
+  sizes_.clear ();
+  QWriteLocker locker (&lock_);
+  for (auto &entry: entries_) {
+    const auto isUnit = entry.isUnit;
+    entry = {};
+    entry.isUnit = isUnit;
+  }
+  for (auto &dependents: dependents_) {
+    dependents.clear ();
+  }
+}
+
+IncludeGraph::Read IncludeGraph::read (const QString &fileName,
+                                      const Document::Ptr &document) const {
+  Read result;
+  if (document) {
+    result.revision = document->revision ();
+    result.includes = document->includedFiles ();
+    result.includes.removeDuplicates ();
+  }
+
+  if (document && !document->utf8Source ().isEmpty ()) {
+    const auto &source = document->utf8Source ();
+    result.ownWeight = uint (source.size ());
+    result.ownLines = uint (source.count ('\n'));
+    return result;
+  }
+
+  const auto size = sizes_.size (fileName);
+  result.ownWeight = size.bytes;
+  result.ownLines = size.lines;
+  return result;
+}
+
+int IncludeGraph::intern (const QString &fileName) {
+  const auto it = ids_.constFind (fileName);
+  if (it != ids_.cend ()) {
+    return it.value ();
+  }
+  const auto id = paths_.size ();
+  ids_.insert (fileName, id);
+  paths_.append (fileName);
+  entries_.append ({});
+  entries_.last ().isUnit = CppTools::ProjectFile::isSource (
+    CppTools::ProjectFile::classify (fileName));
+  dependents_.append ({});
+  return id;
+}
+
+void IncludeGraph::store (int id, const Read &read) {
+  QVector<int> includes;
+  includes.reserve (read.includes.size ());
+  for (const auto &include: read.includes) {
+    includes.append (intern (include));
+  }
+
+  auto &entry = entries_[id];
+  if (includes != entry.includes) {
+    for (const auto include: entry.includes) {
+      dependents_[include].removeAll (id);
+    }
+    for (const auto include: includes) {
+      dependents_[include].append (id);
+    }
+    entry.includes = includes;
+  }
+  entry.isKnown = true;
+  entry.revision = read.revision;
+  entry.ownWeight = read.ownWeight;
+  entry.ownLines = read.ownLines;
+
+  invalidate (id);
+}
+
+void IncludeGraph::invalidate (int id) {
+  QVector<int> queue {id};
+  QSet<int> visited;
+  while (!queue.isEmpty ()) {
+    const auto current = queue.takeLast ();
+    if (visited.contains (current)) {
+      continue;
+    }
+    visited.insert (current);
+
+    entries_[current].hasWeight = false;
+    queue += dependents_[current];
+  }
+
+  // any change moves costs of units, which headers pass on to their includes
+  for (auto &entry: entries_) {
+    entry.hasDependents = false;
+  }
+}
+
+uint IncludeGraph::weight (int id) {
+  auto &entry = entries_[id];
+  if (entry.hasWeight) {
+    return entry.weight;
+  }
+
+  auto result = 0u;
+  QVector<bool> visited (paths_.size ()); // shared includes are counted once
+  QVector<int> queue {id};
+  visited[id] = true;
+  while (!queue.isEmpty ()) {
+    const auto current = queue.takeLast ();
+    result += entries_[current].ownWeight;
+    for (const auto include: entries_[current].includes) {
+      if (!visited[include]) {
+        visited[include] = true;
+        queue.append (include);
+      }
+    }
+  }
+
+  entry.weight = result;
+  entry.hasWeight = true;
+  return result;
+}
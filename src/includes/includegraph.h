@@ -0,0 +1,96 @@
+#pragma once
+
+#include "filesizecache.h"
+
+#include <cplusplus/CppDocument.h>
+
+#include <QHash>
+#include <QSet>
+#include <QReadWriteLock>
+
+namespace CPlusPlus {
+  class Snapshot;
+}
+
+// Compact copy of the graph part reachable from some files.
+// Nodes are numbered in discovery order, edges are stored in CSR form:
+// targets of node i are edges[offsets[i]] .. edges[offsets[i + 1] - 1].
+struct IncludeSubgraph {
+  QVector<int> files;       // node -> file id
+  QVector<QString> paths;   // node -> file name
+  QVector<uint> ownWeights; // node -> own size in bytes
+  QVector<uint> ownLines;   // node -> own size in lines
+  QVector<bool> isUnit;     // node -> is translation unit
+  QVector<int> offsets;
+  QVector<int> edges;
+
+  int size () const {
+    return files.size ();
+  }
+};
+
+// Persistent include graph shared between organize runs.
+// Entries are keyed by document revision and refreshed only when changed.
+// All methods are thread safe, expansion reads documents in parallel.
+// File names are interned to integer ids, which are never reused.
+// Sizes of files without parsed source are read from disk once.
+// Reverse edges are kept too, to find files affected by a change.
+class IncludeGraph {
+  public:
+    struct Dependents {
+      int units = 0;             // translation units including file transitively
+      quint64 recompiled = 0u;   // their weights
+    };
+
+    int id (const QString &fileName) const;
+    QString fileName (int id) const;
+
+    bool contains (const QString &fileName) const;
+    uint ownWeight (const QString &fileName) const;
+    uint weight (const QString &fileName); // with all includes, each counted once
+    QStringList includes (const QString &fileName) const;
+    Dependents dependents (const QString &fileName);
+    // costs computed earlier, without reading files or walking the graph
+    bool cachedCosts (const QString &fileName, uint &weight, Dependents &dependents) const;
+
+    IncludeSubgraph subgraph (const QVector<int> &roots) const;
+
+    void expand (const QString &fileName, const CPlusPlus::Snapshot &snapshot);
+    void expand (const QStringList &fileNames, const CPlusPlus::Snapshot &snapshot);
+    void update (const CPlusPlus::Document::Ptr &document);
+    void remove (const QStringList &fileNames);
+    void clear ();
+
+  private:
+    struct Entry {
+      bool isKnown = false;
+      bool isUnit = false;
+      bool hasWeight = false;
+      bool hasDependents = false;
+      unsigned revision = 0u;
+      uint ownWeight = 0u;
+      uint ownLines = 0u;
+      uint weight = 0u;
+      Dependents dependents;
+      QVector<int> includes;
+    };
+    struct Read {
+      unsigned revision = 0u;
+      uint ownWeight = 0u;
+      uint ownLines = 0u;
+      QStringList includes;
+    };
+
+    Read read (const QString &fileName, const CPlusPlus::Document::Ptr &document) const;
+    int intern (const QString &fileName);
+    void store (int id, const Read &read);
+    void invalidate (int id);
+    uint weight (int id);
+
+    mutable QReadWriteLock lock_;
+    QHash<QString, int> ids_;
+    QVector<QString> paths_;
+    QVector<Entry> entries_;
+    QVector<QVector<int> > dependents_;
+    mutable FileSizeCache sizes_;
+};
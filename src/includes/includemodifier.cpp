@@ -1,33 +1,35 @@
 #include "includemodifier.h"
 
+#include "includesorter.h"
 #include "includetree.h"
+#include "includetrace.h"
 
-#include <coreplugin/editormanager/editormanager.h>
-
-#include <texteditor/texteditor.h>
-#include <texteditor/textdocument.h>
 #include <texteditor/textdocumentlayout.h>
-#include <texteditor/codeassist/textdocumentmanipulator.h>
 
 #include <utils/qtcassert.h>
 
-#include <QDebug>
+#include <QTextBlock>
+#include <QTextCursor>
+#include <QTextDocument>
 
-IncludeModifier::IncludeModifier (CPlusPlus::Document::Ptr document) :
-  document_ (document) {
-  qCritical () << "IncludeModifier for document" << document_->fileName ();
+IncludeModifier::IncludeModifier (CPlusPlus::Document::Ptr document, QTextDocument *textDocument) :
+  document_ (document),
+  textDocument_ (textDocument) {
+  QTC_ASSERT (textDocument_, return );
+  INCLUDES_TRACE << "IncludeModifier for document" << document_->fileName ();
+  lines_ = preambleLines ();
+  findIncludeGroups ();
+}
 
-  auto editor = qobject_cast<TextEditor::BaseTextEditor *>(
-    Core::EditorManager::openEditor (document_->fileName ()));
-  if (editor) {
-    qCritical () << "IncludeModifier opened editor" << editor->document ()->filePath ();
-    textDocument_ = editor->textDocument ()->document ();
-  }
-  unfoldDocument ();
+IncludeModifier::IncludeModifier (CPlusPlus::Document::Ptr document, const QStringList &lines) :
+  document_ (document),
+  textDocument_ (nullptr),
+  lines_ (lines) {
+  findIncludeGroups ();
 }
 
 void IncludeModifier::queueDuplicatesRemoval () {
-  qCritical () << "queueDuplicatesRemoval";
+  INCLUDES_TRACE << "queueDuplicatesRemoval";
   QTC_ASSERT (document_, return );
   QSet<QString> used;
   for (const auto &include: document_->resolvedIncludes ()) {
@@ -38,106 +40,368 @@ void IncludeModifier::queueDuplicatesRemoval () {
       used.insert (include.resolvedFileName ());
       continue;
     }
-    qCritical () << "remove duplicate" << include.line () << include.unresolvedFileName ();
+    INCLUDES_TRACE << "remove duplicate" << include.line () << include.unresolvedFileName ();
     removeIncludeAt (include.line () - 1);
   }
 }
 
 void IncludeModifier::queueUpdates (const IncludeTree &tree) {
   const auto become = tree.includes ();
-  qCritical () << "queueUpdates. Used" << become;
+  INCLUDES_TRACE << "queueUpdates. Used" << become;
   for (const auto &include: document_->resolvedIncludes ()) {
     if (include.line () < 1) {
       continue;
     }
-    qCritical () << "resolved include of" << document_->fileName ()
-                 << include.resolvedFileName () << include.unresolvedFileName ()
-                 << include.line ();
+    INCLUDES_TRACE << "resolved include of" << document_->fileName ()
+                   << include.resolvedFileName () << include.unresolvedFileName ()
+                   << include.line ();
     if (!become.contains (include.resolvedFileName ())) {
-      qCritical () << "remove include" << include.line () << include.unresolvedFileName ()
-                   << include.resolvedFileName ();
+      INCLUDES_TRACE << "remove include" << include.line () << include.unresolvedFileName ()
+                     << include.resolvedFileName ();
       removeIncludeAt (include.line () - 1);
     }
   }
 }
 
+void IncludeModifier::queueAdditions (const QStringList &directives) {
+  INCLUDES_TRACE << "queueAdditions" << directives;
+  QTC_ASSERT (document_, return );
+  for (const auto &directive: directives) {
+    if (!lines_.contains (directive)) {
+      linesToInsert_[insertionLine (directive)].append (directive);
+    }
+  }
+}
+
+void IncludeModifier::queueReplacement (const QString &fileName, const QStringList &lines) {
+  INCLUDES_TRACE << "queueReplacement" << fileName << lines;
+  QTC_ASSERT (document_, return );
+  auto isFirst = true;
+  for (const auto &include: document_->resolvedIncludes ()) {
+    if (include.line () < 1 || include.resolvedFileName () != fileName) {
+      continue;
+    }
+    linesToRemove_.insert (include.line () - 1);
+    if (isFirst) {
+      linesToInsert_[include.line () - 1] += lines;
+      isFirst = false;
+    }
+  }
+}
+
+void IncludeModifier::queueSorting (const IncludeSorter &sorter) {
+  INCLUDES_TRACE << "queueSorting";
+  QTC_ASSERT (document_, return );
+  if (includeGroups_.isEmpty ()) {
+    return;
+  }
+
+  const auto first = includeGroups_.first ().first;
+  auto last = includeGroups_.first ().second;
+  for (auto i = 1, end = includeGroups_.size (); i < end; ++i) {
+    auto isSeparated = true;
+    for (auto line = last + 1; line < includeGroups_[i].first; ++line) {
+      isSeparated = isSeparated && lines_[line].trimmed ().isEmpty ();
+    }
+    if (!isSeparated) {
+      break;
+    }
+    last = includeGroups_[i].second;
+  }
+
+  // queued changes inside the block become part of it
+  QStringList directives;
+  QStringList others;
+  auto isChanged = false;
+  const auto takeInserted = [this, &directives, &others, &isChanged](int line) {
+                              for (const auto &inserted: linesToInsert_.take (line)) {
+                                (IncludeSorter::spelling (inserted).isEmpty () ? others : directives)
+                                .append (inserted);
+                                isChanged = true;
+                              }
+                            };
+  QStringList block;
+  for (auto line = first; line <= last; ++line) {
+    takeInserted (line);
+    block.append (lines_[line]);
+    if (linesToRemove_.contains (line)) {
+      isChanged = true;
+    }
+    else if (!lines_[line].trimmed ().isEmpty ()) {
+      directives.append (lines_[line]);
+    }
+  }
+  takeInserted (last + 1);
+
+  auto sorted = sorter.sort (directives, document_->fileName ());
+  if (!isChanged && sorted == block) {
+    return;
+  }
+  if (!others.isEmpty ()) {
+    sorted << QString () << others;
+  }
+  for (auto line = first; line <= last; ++line) {
+    linesToRemove_.insert (line);
+  }
+  if (!sorted.isEmpty ()) {
+    linesToInsert_[first] = sorted;
+  }
+}
+
 void IncludeModifier::executeQueue () {
-  qCritical () << "executeQueue";
-  std::sort (linesToRemove_.begin (), linesToRemove_.end (), std::greater<int>());
-  for (auto line: linesToRemove_) {
-    auto c = QTextCursor (textDocument_->findBlockByLineNumber (line));
-    c.select (QTextCursor::LineUnderCursor);
-    c.removeSelectedText ();
-    c.deleteChar ();       // for eol
+  INCLUDES_TRACE << "executeQueue";
+  QTC_ASSERT (textDocument_, return );
+
+  // removed lines merged to ranges, not spanning insertion points
+  struct Edit {
+    int firstLine;
+    int lastLine; // firstLine - 1 for pure insertion
+  };
+  QVector<Edit> edits;
+  QSet<int> firstLines;
+  for (const auto line: queuedLines ()) {
+    if (!edits.isEmpty () && edits.last ().lastLine == line - 1
+        && !linesToInsert_.contains (line)) {
+      edits.last ().lastLine = line;
+      continue;
+    }
+    edits.append ({line, line});
+    firstLines.insert (line);
   }
+  for (auto it = linesToInsert_.cbegin (), end = linesToInsert_.cend (); it != end; ++it) {
+    if (!firstLines.contains (it.key ())) {
+      edits.append ({it.key (), it.key () - 1});
+    }
+  }
+  std::sort (edits.begin (), edits.end (), [](const Edit &l, const Edit &r) {
+    return l.firstLine > r.firstLine;
+  });
+  if (edits.isEmpty ()) {
+    return;
+  }
+  unfoldLines (edits.last ().firstLine, std::max (edits.first ().firstLine, edits.first ().lastLine));
+
+  // bottom up, so positions of lines above stay valid
+  const auto blockCount = textDocument_->blockCount ();
+  const auto documentEnd = textDocument_->characterCount () - 1;
+  const auto lineStart = [this, blockCount, documentEnd](int line) {
+                           return line < blockCount
+                                  ? textDocument_->findBlockByNumber (line).position ()
+                                  : documentEnd;
+                         };
+
+  QTextCursor cursor (textDocument_);
+  cursor.beginEditBlock ();
+  for (const auto &edit: edits) {
+    if (edit.lastLine >= edit.firstLine) {
+      auto start = lineStart (edit.firstLine);
+      const auto end = lineStart (edit.lastLine + 1);
+      if (edit.lastLine + 1 >= blockCount && start > 0) {
+        --start; // eol of previous line
+      }
+      cursor.setPosition (start);
+      cursor.setPosition (end, QTextCursor::KeepAnchor);
+      cursor.removeSelectedText ();
+    }
+
+    const auto inserted = linesToInsert_.find (edit.firstLine);
+    if (inserted != linesToInsert_.end ()) {
+      const auto text = inserted.value ().join (QLatin1Char ('\n'));
+      if (edit.firstLine < textDocument_->blockCount ()) {
+        cursor.setPosition (textDocument_->findBlockByNumber (edit.firstLine).position ());
+        cursor.insertText (text + QLatin1Char ('\n'));
+      }
+      else {
+        cursor.movePosition (QTextCursor::End);
+        cursor.insertText (QLatin1Char ('\n') + text);
+      }
+    }
+  }
+  cursor.endEditBlock ();
   linesToRemove_.clear ();
+  linesToInsert_.clear ();
+}
+
+QVector<int> IncludeModifier::queuedLines () const {
+  QVector<int> result (linesToRemove_.cbegin (), linesToRemove_.cend ());
+  std::sort (result.begin (), result.end ());
+  return result;
+}
+
+QMap<int, QStringList> IncludeModifier::queuedInsertions () const {
+  return linesToInsert_;
 }
 
 void IncludeModifier::removeIncludeAt (int line) {
-  linesToRemove_.append (line);
+  linesToRemove_.insert (line);
   if (isGroupRemoved (line)) {
     removeTillNextGroup (line);
   }
 }
 
+void IncludeModifier::findIncludeGroups () {
+  includeGroups_.clear ();
+  for (auto line = 0, end = lines_.size (); line < end; ++line) {
+    if (IncludeSorter::spelling (lines_[line]).isEmpty ()) {
+      continue;
+    }
+    if (!includeGroups_.isEmpty () && includeGroups_.last ().second == line - 1) {
+      includeGroups_.last ().second = line;
+    }
+    else {
+      includeGroups_.append ({line, line});
+    }
+  }
+}
+
 void IncludeModifier::removeTillNextGroup (int line) {
-  auto c = QTextCursor (textDocument_->findBlockByLineNumber (line));
   auto inBlock = true;
-  while (true) {
-    ++line;
-    if (!c.movePosition (QTextCursor::Down)) {
-      break;
-    }
-    if (!c.block ().text ().isEmpty ()) {
+  while (++line < lines_.size ()) {
+    if (!lines_[line].trimmed ().isEmpty ()) {
       if (inBlock) {
         continue;
       }
       break;
     }
     inBlock = false;
-    linesToRemove_.append (line);
+    linesToRemove_.insert (line);
   }
 }
 
-void IncludeModifier::unfoldDocument () {
-  for (auto i = 0, end = textDocument_->blockCount (); i < end; ++i) {
-    auto block = textDocument_->findBlockByNumber (i);
-    if (TextEditor::TextDocumentLayout::isFolded (block)) {
-      TextEditor::TextDocumentLayout::doFoldOrUnfold (block, true);
+int IncludeModifier::insertionLine (const QString &directive) const {
+  using Include = CPlusPlus::Document::Include;
+  auto includes = document_->resolvedIncludes ();
+  includes.erase (std::remove_if (includes.begin (), includes.end (), [](const Include &i) {
+    return i.line () < 1;
+  }), includes.end ());
+  if (includes.isEmpty ()) {
+    return preambleEnd ();
+  }
+  std::sort (includes.begin (), includes.end (), [](const Include &l, const Include &r) {
+    return l.line () < r.line ();
+  });
+
+  const auto name = directive.mid (directive.indexOf (QLatin1Char (' ')) + 1);
+  const auto isGlobal = name.startsWith (QLatin1Char ('<'));
+  const auto spelling = name.mid (1, name.size () - 2);
+
+  // groups are runs of include lines, best one has the same include type
+  // and the longest common prefix with the new include
+  auto bestScore = -1;
+  auto bestLine = 0;
+  for (auto first = 0; first < includes.size ();) {
+    auto last = first;
+    while (last + 1 < includes.size () && includes[last + 1].line () == includes[last].line () + 1) {
+      ++last;
     }
+
+    auto score = (includes[first].type () == CPlusPlus::Client::IncludeGlobal) == isGlobal
+                 ? 1000 : 0;
+    auto prefix = 0;
+    auto isSorted = true;
+    auto line = includes[last].line ();     // after group, 0-based
+    for (auto i = first; i <= last; ++i) {
+      const auto other = includes[i].unresolvedFileName ();
+      auto common = 0;
+      while (common < other.size () && common < spelling.size ()
+             && other[common] == spelling[common]) {
+        ++common;
+      }
+      prefix = std::max (prefix, common);
+      isSorted = isSorted && (i == first || includes[i - 1].unresolvedFileName ()
+                              .compare (other, Qt::CaseInsensitive) <= 0);
+    }
+    if (isSorted) {
+      for (auto i = first; i <= last; ++i) {
+        if (includes[i].unresolvedFileName ().compare (spelling, Qt::CaseInsensitive) > 0) {
+          line = includes[i].line () - 1;
+          break;
+        }
+      }
+    }
+
+    score += prefix;
+    if (score > bestScore) {
+      bestScore = score;
+      bestLine = line;
+    }
+    first = last + 1;
   }
+  return bestLine;
 }
 
-bool IncludeModifier::isGroupRemoved (int line) const {
-  auto c = QTextCursor (textDocument_->findBlockByLineNumber (line));
-
-  while (true) {
+int IncludeModifier::preambleEnd () const {
+  // after leading comments and include guard
+  auto line = 0;
+  while (line < lines_.size () && (lines_[line].trimmed ().isEmpty ()
+                                   || lines_[line].trimmed ().startsWith (QLatin1String ("//")))) {
     ++line;
-    if (!c.movePosition (QTextCursor::Down)) {
-      break;
+  }
+  if (line < lines_.size () && lines_[line].trimmed ().startsWith (QLatin1String ("#pragma once"))) {
+    return line + 1;
+  }
+  if (line + 1 < lines_.size () && lines_[line].trimmed ().startsWith (QLatin1String ("#ifndef"))
+      && lines_[line + 1].trimmed ().startsWith (QLatin1String ("#define"))) {
+    return line + 2;
+  }
+  return line;
+}
+
+QStringList IncludeModifier::preambleLines () const {
+  auto lastInclude = -1;
+  for (const auto &include: document_->resolvedIncludes () + document_->unresolvedIncludes ()) {
+    lastInclude = std::max (lastInclude, include.line () - 1);
+  }
+
+  // till the second code line after includes, enough for group ends and guards
+  QStringList result;
+  auto codeLines = 0;
+  auto line = 0;
+  for (auto block = textDocument_->begin (); block.isValid (); block = block.next (), ++line) {
+    const auto text = block.text ();
+    result.append (text);
+    if (line <= lastInclude) {
+      continue;
     }
-    if (c.block ().text ().isEmpty ()) {
+    const auto trimmed = text.trimmed ();
+    if (!trimmed.isEmpty () && !trimmed.startsWith (QLatin1String ("//")) && ++codeLines == 2) {
       break;
     }
-    if (linesToRemove_.contains (line)) {
-      continue;
+  }
+  return result;
+}
+
+void IncludeModifier::unfoldLines (int firstLine, int lastLine) {
+  // folded region, hiding edited lines, may start before them
+  auto block = textDocument_->findBlockByNumber (firstLine);
+  while (block.isValid () && !block.isVisible () && block.previous ().isValid ()) {
+    block = block.previous ();
+  }
+  for (auto line = block.blockNumber (); block.isValid () && line <= lastLine;
+       block = block.next (), ++line) {
+    if (TextEditor::TextDocumentLayout::isFolded (block)) {
+      TextEditor::TextDocumentLayout::doFoldOrUnfold (block, true);
     }
-    return false;
   }
+}
 
-  c = QTextCursor (textDocument_->findBlockByLineNumber (line));
-  while (true) {
-    --line;
-    if (!c.movePosition (QTextCursor::Up)) {
+bool IncludeModifier::isGroupRemoved (int line) const {
+  for (auto i = line + 1; i < lines_.size (); ++i) {
+    if (lines_[i].trimmed ().isEmpty ()) {
       break;
     }
-    if (c.block ().text ().isEmpty ()) {
+    if (!linesToRemove_.contains (i)) {
+      return false;
+    }
+  }
+
+  for (auto i = line - 1; i >= 0; --i) {
+    if (lines_[i].trimmed ().isEmpty ()) {
       break;
     }
-    if (linesToRemove_.contains (line)) {
-      continue;
+    if (!linesToRemove_.contains (i)) {
+      return false;
     }
-    return false;
   }
 
   return true;
@@ -3,28 +3,47 @@
 #include <cplusplus/CppDocument.h>
 
 #include <QMap>
+#include <QSet>
 
+class IncludeSorter;
 class IncludeTree;
 class QTextCursor;
 class QTextDocument;
 
+// Edits includes of a document. Only the preamble (lines up to the second
+// non-comment code line after the last include) is read and modified.
+// Include groups are runs of include lines, the include block is the
+// first groups separated only by blank lines.
 class IncludeModifier {
   public:
-    explicit IncludeModifier (CPlusPlus::Document::Ptr document);
+    IncludeModifier (CPlusPlus::Document::Ptr document, QTextDocument *textDocument);
+    IncludeModifier (CPlusPlus::Document::Ptr document, const QStringList &lines);
 
     void queueDuplicatesRemoval ();
     void queueUpdates (const IncludeTree &tree);
+    void queueAdditions (const QStringList &directives);
+    void queueReplacement (const QString &fileName, const QStringList &lines);
+    void queueSorting (const IncludeSorter &sorter);
     void executeQueue ();
 
+    QVector<int> queuedLines () const;
+    QMap<int, QStringList> queuedInsertions () const;
+
   private:
     void removeIncludeAt (int line);
-    void unfoldDocument ();
+    void findIncludeGroups ();
+    QStringList preambleLines () const;
+    void unfoldLines (int firstLine, int lastLine);
     bool isGroupRemoved (int line) const;
     void removeTillNextGroup (int line);
+    int insertionLine (const QString &directive) const;
+    int preambleEnd () const;
 
     CPlusPlus::Document::Ptr document_;
     QTextDocument *textDocument_;
-    QVector<int> linesToRemove_;
-    QVector<QPair<int, int> > includeGroups_;
+    QStringList lines_;
+    QSet<int> linesToRemove_;
+    QMap<int, QStringList> linesToInsert_; // line to insert before -> directives
+    QVector<QPair<int, int> > includeGroups_; // first and last lines
 };
 
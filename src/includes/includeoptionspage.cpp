@@ -0,0 +1,131 @@
+#include "includeoptionspage.h"
+
+#include <coreplugin/icore.h>
+
+#include <QLabel>
+#include <QPlainTextEdit>
+#include <QVBoxLayout>
+
+namespace QtcUtilities {
+  namespace Internal {
+    namespace IncludeUtils {
+
+      namespace {
+        const char OPTIONS_PAGE_ID[] = "IncludeUtils.OptionaPageId";
+        const char OPTIONS_CATEGORY_ID[] = "QtcUtilities.CategoryId";
+        const char OPTIONS_CATEGORY_ICON[] = ":/resources/section.png";
+
+        const QString SETTINGS_GROUP = QLatin1String ("IncludeUtils");
+        const QString SETTINGS_SORT_RULES = QLatin1String ("sortRules");
+
+        // rule per line as name=pattern
+        QStringList toLines (const QVector<IncludeSortRule> &rules) {
+          QStringList result;
+          for (const auto &rule: rules) {
+            result.append (rule.name + QLatin1Char ('=') + rule.pattern);
+          }
+          return result;
+        }
+
+        QVector<IncludeSortRule> fromLines (const QStringList &lines) {
+          QVector<IncludeSortRule> result;
+          for (const auto &line: lines) {
+            const auto separator = line.indexOf (QLatin1Char ('='));
+            if (separator < 0 || line.trimmed ().isEmpty ()) {
+              continue;
+            }
+            result.append ({line.left (separator).trimmed (), line.mid (separator + 1).trimmed ()});
+          }
+          return result;
+        }
+      }
+
+
+      class OptionsWidget : public QWidget {
+        Q_OBJECT
+
+        public:
+          OptionsWidget ();
+
+          void set (const QVector<IncludeSortRule> &rules);
+          void get (QVector<IncludeSortRule> &rules) const;
+
+        private:
+          QPlainTextEdit *rulesEdit_;
+      };
+
+      OptionsWidget::OptionsWidget () :
+        rulesEdit_ (new QPlainTextEdit) {
+        auto layout = new QVBoxLayout;
+        auto label = new QLabel (tr ("Include groups in sort order, one name=regular expression "
+                                     "per line. Expressions are matched against include with "
+                                     "quotes or brackets. Own header always goes first."));
+        label->setWordWrap (true);
+        layout->addWidget (label);
+        layout->addWidget (rulesEdit_);
+        setLayout (layout);
+      }
+
+      void OptionsWidget::set (const QVector<IncludeSortRule> &rules) {
+        rulesEdit_->setPlainText (toLines (rules).join (QLatin1Char ('\n')));
+      }
+
+      void OptionsWidget::get (QVector<IncludeSortRule> &rules) const {
+        rules = fromLines (rulesEdit_->toPlainText ().split (QLatin1Char ('\n')));
+      }
+
+
+
+
+      IncludeOptionsPage::IncludeOptionsPage (QObject *parent)
+        : IOptionsPage (parent), widget_ (nullptr), sortRules_ (IncludeSorter::defaultRules ()) {
+        setId (OPTIONS_PAGE_ID);
+        setDisplayName (tr ("Includes"));
+        setCategory (OPTIONS_CATEGORY_ID);
+        setDisplayCategory (tr ("Utilities"));
+        setCategoryIcon (Utils::Icon (OPTIONS_CATEGORY_ICON));
+
+        load ();
+      }
+
+      QWidget *IncludeOptionsPage::widget () {
+        if (!widget_) {
+          widget_ = new OptionsWidget;
+        }
+        widget_->set (sortRules_);
+        return widget_.data ();
+      }
+
+      void IncludeOptionsPage::apply () {
+        widget_->get (sortRules_);
+        save ();
+      }
+
+      void IncludeOptionsPage::finish () {
+      }
+
+      const QVector<IncludeSortRule> &IncludeOptionsPage::sortRules () const {
+        return sortRules_;
+      }
+
+      void IncludeOptionsPage::load () {
+        QSettings &qsettings = *(Core::ICore::settings ());
+        qsettings.beginGroup (SETTINGS_GROUP);
+        if (qsettings.contains (SETTINGS_SORT_RULES)) {
+          sortRules_ = fromLines (qsettings.value (SETTINGS_SORT_RULES).toStringList ());
+        }
+        qsettings.endGroup ();
+      }
+
+      void IncludeOptionsPage::save () {
+        QSettings &qsettings = *(Core::ICore::settings ());
+        qsettings.beginGroup (SETTINGS_GROUP);
+        qsettings.setValue (SETTINGS_SORT_RULES, toLines (sortRules_));
+        qsettings.endGroup ();
+      }
+
+    } // namespace IncludeUtils
+  } // namespace Internal
+} // namespace QtcUtilities
+
+#include "includeoptionspage.moc"
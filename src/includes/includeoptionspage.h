@@ -0,0 +1,36 @@
+#pragma once
+
+#include "includesorter.h"
+
+#include <coreplugin/dialogs/ioptionspage.h>
+
+#include <QPointer>
+
+namespace QtcUtilities {
+  namespace Internal {
+    namespace IncludeUtils {
+
+      class OptionsWidget;
+
+      class IncludeOptionsPage : public Core::IOptionsPage {
+        public:
+          explicit IncludeOptionsPage (QObject *parent);
+          QWidget *widget () override;
+          void apply () override;
+          void finish () override;
+
+          const QVector<IncludeSortRule> &sortRules () const;
+
+        private:
+          void load ();
+          void save ();
+
+          QPointer<OptionsWidget> widget_;
+          QVector<IncludeSortRule> sortRules_;
+
+          Q_DISABLE_COPY (IncludeOptionsPage)
+      };
+
+    } // namespace IncludeUtils
+  } // namespace Internal
+} // namespace QtcUtilities
@@ -0,0 +1,168 @@
+#include "includeorganizer.h"
+#include "includeextractor.h"
+#include "includetree.h"
+#include "includetrace.h"
+
+#include <cplusplus/CppDocument.h>
+#include <cplusplus/Overview.h>
+#include <cplusplus/Symbols.h>
+
+#include <QDir>
+
+#include <algorithm>
+
+using namespace CPlusPlus;
+
+namespace {
+  enum Step {
+    StepPreprocess, StepExtract, StepBuild, StepDistribute, StepReduce, StepCount
+  };
+
+  // spelling used for file by other documents or path relative to document
+  QStringList includeDirectives (const QStringList &fileNames, const Document::Ptr &document,
+                                 const Snapshot &snapshot) {
+    const auto directory = QFileInfo (document->fileName ()).absolutePath ();
+    const QSet<QString> wanted (fileNames.cbegin (), fileNames.cend ());
+    QHash<QString, QString> spellings;
+    for (auto it = snapshot.begin (), end = snapshot.end ();
+         it != end && spellings.size () < wanted.size (); ++it) {
+      for (const auto &include: it.value ()->resolvedIncludes ()) {
+        const auto &fileName = include.resolvedFileName ();
+        if (!wanted.contains (fileName) || spellings.contains (fileName)) {
+          continue;
+        }
+        if (include.type () == Client::IncludeGlobal) {
+          spellings.insert (fileName, '<' + include.unresolvedFileName () + '>');
+        }
+        else if (QFileInfo (it.value ()->fileName ()).absolutePath () == directory) {
+          spellings.insert (fileName, '"' + include.unresolvedFileName () + '"');
+        }
+      }
+    }
+
+    QStringList result;
+    for (const auto &fileName: fileNames) {
+      auto spelling = spellings.value (fileName);
+      if (spelling.isEmpty ()) {
+        spelling = '"' + QDir (directory).relativeFilePath (fileName) + '"';
+      }
+      result.append (QLatin1String ("#include ") + spelling);
+    }
+    return result;
+  }
+
+  QString forwardDeclaration (Symbol *symbol) {
+    Overview overview;
+    const auto cls = symbol->asClass ();
+    auto result = QString (cls && cls->isStruct () ? "struct %1;" : "class %1;")
+                  .arg (overview.prettyName (symbol->name ()));
+    for (auto scope = symbol->enclosingScope (); scope && scope->enclosingScope ();
+         scope = scope->enclosingScope ()) {
+      result = QString ("namespace %1 { %2 }").arg (overview.prettyName (scope->name ()), result);
+    }
+    return result;
+  }
+}
+
+OrganizeResult analyzeIncludes (const Snapshot &snapshot,
+                                const QByteArray &contents, const QString &fileName,
+                                IncludeGraph &graph, LookupCache *lookups,
+                                QFutureInterfaceBase *future, IncludeExtractor::Mode mode) {
+  INCLUDES_TRACE_SCOPE ("analyzeIncludes");
+  const auto isCanceled = [future] {
+                            return future && future->isCanceled ();
+                          };
+  const auto setProgress = [future](int step) {
+                             if (future) {
+                               future->setProgressValue (step);
+                             }
+                           };
+
+  setProgress (StepPreprocess);
+  auto cppDocument = snapshot.preprocessedDocument (contents, fileName);
+  if (!cppDocument || !cppDocument->parse ()) {
+    qCWarning (includesLog) << "parse failed" << fileName;
+    return {};
+  }
+  cppDocument->check ();
+
+  auto control = cppDocument->control ();
+  if (control->symbolCount () == 0 || !control->firstSymbol ()) {
+    qCWarning (includesLog) << "no symbols" << fileName;
+    return {};
+  }
+  if (cppDocument->fileName ().isEmpty () || isCanceled ()) {
+    return {};
+  }
+
+  setProgress (StepExtract);
+  IncludeExtractor extractor (cppDocument, snapshot, lookups, mode);
+  if (isCanceled ()) {
+    return {};
+  }
+
+  setProgress (StepBuild);
+  auto tree = QSharedPointer<IncludeTree>::create (cppDocument->fileName (), graph);
+  tree->build (snapshot);
+  INCLUDES_TRACE << "was" << tree->includes ();
+  if (isCanceled ()) {
+    return {};
+  }
+
+  setProgress (StepDistribute);
+  tree->distribute (extractor.symbols ());
+  INCLUDES_TRACE << "distributed symbols" << tree->root ().allSymbols ().size ()
+                 << "from" << extractor.symbols ().size ();
+
+  tree->distribute (cppDocument->macroUses ());
+  INCLUDES_TRACE << "distributed macros" << tree->root ().allMacros ().size ()
+                 << "from" << cppDocument->macroUses ().size ();
+  if (isCanceled ()) {
+    return {};
+  }
+
+  setProgress (StepReduce);
+  tree->removeEmptyPaths ();
+  INCLUDES_TRACE << "removed empty" << tree->includes ();
+
+  tree->removeNestedPaths ();
+  INCLUDES_TRACE << "removed nested" << tree->includes ();
+  if (isCanceled ()) {
+    return {};
+  }
+
+  setProgress (StepCount);
+  const auto additions = includeDirectives (tree->missingIncludes (), cppDocument, snapshot);
+  INCLUDES_TRACE << "missing" << additions;
+
+  QVector<ForwardDeclarations> forwardDeclarations;
+  for (const auto &declarable: tree->forwardDeclarable (extractor.completeUses ())) {
+    const auto &classes = declarable.classes;
+    if (!std::all_of (classes.cbegin (), classes.cend (), isForwardDeclarable)) {
+      continue;
+    }
+    QStringList declarations;
+    for (const auto symbol: classes) {
+      declarations.append (forwardDeclaration (symbol));
+    }
+    declarations.removeDuplicates ();
+    forwardDeclarations.append ({declarable.fileName, declarations, declarable.savedWeight});
+  }
+
+  const auto &unresolved = extractor.unresolved ();
+  return {snapshot, cppDocument, tree, QStringList (unresolved.cbegin (), unresolved.cend ()),
+          additions, forwardDeclarations};
+}
+
+void organizeIncludes (QFutureInterface<OrganizeResult> &future,
+                       const Snapshot &snapshot,
+                       const QByteArray &contents, const QString &fileName,
+                       QSharedPointer<IncludeGraph> graph,
+                       QSharedPointer<LookupCache> lookups) {
+  future.setProgressRange (0, StepCount);
+  const auto result = analyzeIncludes (snapshot, contents, fileName, *graph,
+                                       lookups.data (), &future, IncludeExtractor::Mode::Parallel);
+  if (result.tree) {
+    future.reportResult (result);
+  }
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "includeextractor.h"
+
+#include <cplusplus/CppDocument.h>
+
+#include <QFutureInterface>
+#include <QSharedPointer>
+
+class IncludeGraph;
+class LookupCache;
+class IncludeTree;
+
+struct ForwardDeclarations {
+  QString fileName; // include to replace
+  QStringList declarations;
+  quint64 savedWeight = 0u;
+};
+
+struct OrganizeResult {
+  CPlusPlus::Snapshot snapshot;
+  CPlusPlus::Document::Ptr document;
+  QSharedPointer<IncludeTree> tree;
+  QStringList unresolved;
+  QStringList additions; // include directives of missing includes
+  QVector<ForwardDeclarations> forwardDeclarations; // most saving first
+};
+
+// Runs the whole analysis part of include organizing: preprocessing,
+// symbols extraction and tree reduction. Does not touch the text.
+OrganizeResult analyzeIncludes (const CPlusPlus::Snapshot &snapshot,
+                                const QByteArray &contents, const QString &fileName,
+                                IncludeGraph &graph, LookupCache *lookups = nullptr,
+                                QFutureInterfaceBase *future = nullptr,
+                                IncludeExtractor::Mode mode = IncludeExtractor::Mode::Sequential);
+
+// Single document analysis, extraction is split between threads.
+void organizeIncludes (QFutureInterface<OrganizeResult> &future,
+                       const CPlusPlus::Snapshot &snapshot,
+                       const QByteArray &contents, const QString &fileName,
+                       QSharedPointer<IncludeGraph> graph,
+                       QSharedPointer<LookupCache> lookups);
@@ -0,0 +1,162 @@
+#include "includepch.h"
+#include "bitset.h"
+#include "includefanout.h"
+#include "includegraph.h"
+#include "includetrace.h"
+
+#include <QDateTime>
+#include <QFileInfo>
+
+#include <algorithm>
+#include <numeric>
+
+namespace {
+  const auto minUnitsShare = 0.25;
+  const auto maxSize = quint64 (32 * 1024 * 1024);
+  const auto stableAgeDays = 30.; // stability is 0.5 at this age
+
+  class Closure {
+    public:
+      explicit Closure (const IncludeSubgraph &graph) :
+        graph_ (graph),
+        visited_ (graph.size (), -1) {
+      }
+
+      const QVector<int> &of (int root) {
+        ++walk_;
+        nodes_.clear ();
+        nodes_.append (root);
+        visited_[root] = walk_;
+        for (auto i = 0; i < nodes_.size (); ++i) {
+          const auto node = nodes_[i];
+          for (auto edge = graph_.offsets[node], end = graph_.offsets[node + 1]; edge < end; ++edge) {
+            const auto target = graph_.edges[edge];
+            if (visited_[target] != walk_) {
+              visited_[target] = walk_;
+              nodes_.append (target);
+            }
+          }
+        }
+        return nodes_;
+      }
+
+    private:
+      const IncludeSubgraph &graph_;
+      QVector<int> visited_; // last walk that reached node
+      QVector<int> nodes_;
+      int walk_ = -1;
+  };
+}
+
+PchProposal proposePrecompiledHeader (const IncludeSubgraph &graph,
+                                      const QVector<double> &stabilities) {
+  INCLUDES_TRACE_SCOPE ("proposePrecompiledHeader");
+  QVector<int> units;
+  QVector<quint64> recompiled;
+  countIncludingUnits (graph, units, recompiled);
+
+  const auto size = graph.size ();
+  PchProposal result;
+  auto unitCount = 0;
+  for (auto node = 0; node < size; ++node) {
+    result.parsed += quint64 (graph.ownWeights[node]) * units[node];
+    if (graph.isUnit[node]) {
+      ++unitCount;
+    }
+  }
+  const auto minUnits = std::max (2, int (unitCount * minUnitsShare));
+
+  Closure closure (graph);
+  QVector<int> nodes;
+  for (auto node = 0; node < size; ++node) {
+    if (graph.isUnit[node] || units[node] < minUnits) {
+      continue;
+    }
+    PchCandidate candidate;
+    candidate.fileName = graph.paths[node];
+    candidate.units = units[node];
+    for (const auto included: closure.of (node)) {
+      candidate.weight += graph.ownWeights[included];
+    }
+    candidate.stability = stabilities[node];
+    candidate.score = candidate.units * double (candidate.weight) * candidate.stability;
+    result.candidates.append (candidate);
+    nodes.append (node);
+  }
+
+  QVector<int> order (nodes.size ());
+  std::iota (order.begin (), order.end (), 0);
+  std::sort (order.begin (), order.end (), [&result](int l, int r) {
+    return result.candidates[l].score > result.candidates[r].score;
+  });
+
+  // every covered byte is parsed once for the header instead of once per unit
+  Bitset covered (size);
+  QVector<int> chosen;
+  for (const auto i: order) {
+    const auto node = nodes[i];
+    if (covered.test (node) || result.candidates[i].score <= 0.) {
+      continue;
+    }
+    auto added = quint64 (0);
+    auto saved = quint64 (0);
+    for (const auto included: closure.of (node)) {
+      if (!covered.test (included)) {
+        added += graph.ownWeights[included];
+        saved += quint64 (graph.ownWeights[included]) * (units[included] - 1);
+      }
+    }
+    if (saved == 0u || result.size + added > maxSize) {
+      continue;
+    }
+    for (const auto included: closure.of (node)) {
+      covered.set (included);
+    }
+    result.size += added;
+    result.saved += saved;
+    chosen.append (i);
+  }
+
+  // drop headers included by other chosen ones
+  Bitset nested (size);
+  for (const auto i: chosen) {
+    for (const auto included: closure.of (nodes[i])) {
+      if (included != nodes[i]) {
+        nested.set (included);
+      }
+    }
+  }
+  for (const auto i: chosen) {
+    result.candidates[i].isChosen = !nested.test (nodes[i]);
+  }
+
+  QVector<PchCandidate> sorted;
+  sorted.reserve (order.size ());
+  for (const auto i: order) {
+    sorted.append (result.candidates[i]);
+  }
+  result.candidates = sorted;
+  return result;
+}
+
+PchProposal precompiledHeader (const CPlusPlus::Snapshot &snapshot, const QStringList &files,
+                               QSharedPointer<IncludeGraph> graph) {
+  graph->expand (files, snapshot);
+  QVector<int> roots;
+  roots.reserve (files.size ());
+  for (const auto &file: files) {
+    roots.append (graph->id (file));
+  }
+  const auto subgraph = graph->subgraph (roots);
+
+  // time since last change stands for change frequency
+  const auto now = QDateTime::currentDateTime ();
+  QVector<double> stabilities (subgraph.size ());
+  for (auto node = 0; node < subgraph.size (); ++node) {
+    const auto modified = QFileInfo (subgraph.paths[node]).lastModified ();
+    const auto days = modified.isValid () ? std::max (0ll, modified.secsTo (now)) / 86400.
+                                          : stableAgeDays;
+    stabilities[node] = days / (days + stableAgeDays);
+  }
+  return proposePrecompiledHeader (subgraph, stabilities);
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <QSharedPointer>
+#include <QStringList>
+
+namespace CPlusPlus {
+  class Snapshot;
+}
+
+class IncludeGraph;
+struct IncludeSubgraph;
+
+struct PchCandidate {
+  QString fileName;
+  int units = 0;         // including it transitively
+  quint64 weight = 0u;   // with all includes
+  double stability = 0.; // 0 if just changed, goes to 1 for old files
+  double score = 0.;
+  bool isChosen = false;
+};
+
+struct PchProposal {
+  QVector<PchCandidate> candidates; // best score first
+  quint64 size = 0u;    // bytes of the proposed header with includes
+  quint64 saved = 0u;   // bytes not parsed by units anymore
+  quint64 parsed = 0u;  // bytes parsed by all units now
+};
+
+// Ranks headers by units * weight * stability and greedily takes those
+// adding most not yet covered bytes, weighted by units parsing them.
+// Headers included by few units are not offered, they would be forced
+// into every unit.
+PchProposal proposePrecompiledHeader (const IncludeSubgraph &graph,
+                                      const QVector<double> &stabilities);
+
+// Expands the graph from files and proposes a header using file times.
+PchProposal precompiledHeader (const CPlusPlus::Snapshot &snapshot, const QStringList &files,
+                               QSharedPointer<IncludeGraph> graph);
@@ -0,0 +1,117 @@
+#include "includereportpane.h"
+
+#include <coreplugin/editormanager/editormanager.h>
+
+#include <QStandardItemModel>
+
+namespace QtcUtilities {
+  namespace Internal {
+    namespace IncludeUtils {
+
+      IncludeReportPane::IncludeReportPane (QObject *parent)
+        : IOutputPane (parent), widget_ (new QTreeView), model_ (new QStandardItemModel (this)) {
+        model_->setSortRole (SortRole);
+        widget_->setModel (model_);
+        widget_->setEditTriggers (QAbstractItemView::NoEditTriggers);
+        widget_->setSortingEnabled (true);
+        widget_->setUniformRowHeights (true);
+        connect (widget_, &QTreeView::activated, this, [](const QModelIndex &index) {
+          const auto fileName = index.data (FileNameRole).toString ();
+          if (!fileName.isEmpty ()) {
+            Core::EditorManager::openEditor (fileName);
+          }
+        });
+      }
+
+      IncludeReportPane::~IncludeReportPane () {
+        delete widget_;
+      }
+
+      QStandardItem *IncludeReportPane::fileItem (const QString &fileName) {
+        auto item = textItem (fileName);
+        item->setData (fileName, FileNameRole);
+        return item;
+      }
+
+      QStandardItem *IncludeReportPane::textItem (const QString &text) {
+        auto item = new QStandardItem (text);
+        item->setData (text, SortRole);
+        return item;
+      }
+
+      QStandardItem *IncludeReportPane::numberItem (double value, const QString &text) {
+        auto item = new QStandardItem (text);
+        item->setData (value, SortRole);
+        item->setTextAlignment (Qt::AlignRight | Qt::AlignVCenter);
+        return item;
+      }
+
+      void IncludeReportPane::setReport (const QStringList &header,
+                                         const QList<QList<QStandardItem *> > &rows) {
+        model_->clear ();
+        model_->setHorizontalHeaderLabels (header);
+        for (const auto &row: rows) {
+          model_->appendRow (row);
+        }
+        widget_->sortByColumn (-1, Qt::AscendingOrder);
+        widget_->resizeColumnToContents (0);
+        popup (NoModeSwitch);
+      }
+
+      QWidget *IncludeReportPane::outputWidget (QWidget */*parent*/) {
+        return widget_;
+      }
+
+      QList<QWidget *> IncludeReportPane::toolBarWidgets () const {
+        return {};
+      }
+
+      QString IncludeReportPane::displayName () const {
+        return tr ("Includes");
+      }
+
+      int IncludeReportPane::priorityInStatusBar () const {
+        return 10;
+      }
+
+      void IncludeReportPane::clearContents () {
+        model_->clear ();
+      }
+
+      void IncludeReportPane::visibilityChanged (bool visible) {
+        widget_->setVisible (visible);
+      }
+
+      void IncludeReportPane::setFocus () {
+        widget_->setFocus ();
+      }
+
+      bool IncludeReportPane::hasFocus () const {
+        return widget_->hasFocus ();
+      }
+
+      bool IncludeReportPane::canFocus () const {
+        return true;
+      }
+
+      bool IncludeReportPane::canNavigate () const {
+        return false;
+      }
+
+      bool IncludeReportPane::canNext () const {
+        return false;
+      }
+
+      bool IncludeReportPane::canPrevious () const {
+        return false;
+      }
+
+      void IncludeReportPane::goToNext () {
+      }
+
+      void IncludeReportPane::goToPrev () {
+      }
+
+    } // namespace IncludeUtils
+  } // namespace Internal
+} // namespace QtcUtilities
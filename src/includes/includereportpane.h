@@ -0,0 +1,56 @@
+#pragma once
+
+#include <coreplugin/ioutputpane.h>
+
+#include <QTreeView>
+
+class QStandardItem;
+class QStandardItemModel;
+
+namespace QtcUtilities {
+  namespace Internal {
+    namespace IncludeUtils {
+
+      // Shows results of project include analyses as a sortable tree.
+      // Items with file name in FileNameRole open it on activation.
+      class IncludeReportPane : public Core::IOutputPane {
+        Q_OBJECT
+
+        public:
+          enum Role {
+            FileNameRole = Qt::UserRole + 1,
+            SortRole
+          };
+
+          IncludeReportPane (QObject *parent);
+          ~IncludeReportPane ();
+
+          static QStandardItem *fileItem (const QString &fileName);
+          static QStandardItem *textItem (const QString &text);
+          static QStandardItem *numberItem (double value, const QString &text);
+
+          void setReport (const QStringList &header, const QList<QList<QStandardItem *> > &rows);
+
+          QWidget *outputWidget (QWidget *parent) override;
+          QList<QWidget *> toolBarWidgets () const override;
+          QString displayName () const override;
+          int priorityInStatusBar () const override;
+          void clearContents () override;
+          void visibilityChanged (bool visible) override;
+          void setFocus () override;
+          bool hasFocus () const override;
+          bool canFocus () const override;
+          bool canNavigate () const override;
+          bool canNext () const override;
+          bool canPrevious () const override;
+          void goToNext () override;
+          void goToPrev () override;
+
+        private:
+          QTreeView *widget_;
+          QStandardItemModel *model_;
+      };
+
+    } // namespace IncludeUtils
+  } // namespace Internal
+} // namespace QtcUtilities
@@ -0,0 +1,83 @@
+#include "includesorter.h"
+
+#include <QFileInfo>
+#include <QSet>
+
+#include <algorithm>
+
+namespace {
+  const auto ownGroup = -1;
+}
+
+IncludeSorter::IncludeSorter (const QVector<IncludeSortRule> &rules) {
+  for (const auto &rule: rules) {
+    QRegularExpression pattern (rule.pattern);
+    if (pattern.isValid ()) {
+      pattern.optimize ();
+      patterns_.append (pattern);
+    }
+  }
+}
+
+QVector<IncludeSortRule> IncludeSorter::defaultRules () {
+  return {
+    {QLatin1String ("Project"), QLatin1String ("^\".*\"$")},
+    {QLatin1String ("Qt"), QLatin1String ("^<Q\\w*(/\\w+(\\.h)?)?>$")},
+    {QLatin1String ("Standard"), QLatin1String ("^<\\w+>$")},
+    {QLatin1String ("Third-party"), QLatin1String ("^<.*>$")}
+  };
+}
+
+QString IncludeSorter::spelling (const QString &line) {
+  static const QRegularExpression include (QLatin1String ("^\\s*#\\s*include\\s*([<\"][^>\"]*[>\"])"));
+  const auto match = include.match (line);
+  return match.hasMatch () ? match.captured (1) : QString ();
+}
+
+QStringList IncludeSorter::sort (const QStringList &directives, const QString &fileName) const {
+  struct Directive {
+    int group;
+    QString spelling;
+    QString line;
+  };
+  const auto baseName = QFileInfo (fileName).completeBaseName ();
+
+  QVector<Directive> sorted;
+  QSet<QString> spellings;
+  for (const auto &line: directives) {
+    const auto spelling = this->spelling (line);
+    if (spelling.isEmpty () || spellings.contains (spelling)) {
+      continue;
+    }
+    spellings.insert (spelling);
+    sorted.append ({group (spelling, baseName), spelling, line.trimmed ()});
+  }
+  std::stable_sort (sorted.begin (), sorted.end (), [](const Directive &l, const Directive &r) {
+    if (l.group != r.group) {
+      return l.group < r.group;
+    }
+    return l.spelling.compare (r.spelling, Qt::CaseInsensitive) < 0;
+  });
+
+  QStringList result;
+  for (auto i = 0, end = sorted.size (); i < end; ++i) {
+    if (i > 0 && sorted[i].group != sorted[i - 1].group) {
+      result.append (QString ());
+    }
+    result.append (sorted[i].line);
+  }
+  return result;
+}
+
+int IncludeSorter::group (const QString &spelling, const QString &baseName) const {
+  if (spelling.startsWith (QLatin1Char ('"'))
+      && QFileInfo (spelling.mid (1, spelling.size () - 2)).completeBaseName () == baseName) {
+    return ownGroup;
+  }
+  for (auto i = 0, end = patterns_.size (); i < end; ++i) {
+    if (patterns_[i].match (spelling).hasMatch ()) {
+      return i;
+    }
+  }
+  return patterns_.size ();
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <QRegularExpression>
+#include <QVector>
+
+struct IncludeSortRule {
+  QString name;
+  QString pattern; // matched against spelling with brackets or quotes
+};
+
+// Orders include directives: own header of the file first, then groups
+// in order of the first matching rule, unmatched ones last.
+// Directives are sorted by spelling within a group, groups are separated
+// by a blank line. Immutable, so may be shared between threads.
+class IncludeSorter {
+  public:
+    explicit IncludeSorter (const QVector<IncludeSortRule> &rules = defaultRules ());
+
+    static QVector<IncludeSortRule> defaultRules ();
+    static QString spelling (const QString &line); // empty if not an include
+
+    QStringList sort (const QStringList &directives, const QString &fileName) const;
+
+  private:
+    int group (const QString &spelling, const QString &baseName) const;
+
+    QVector<QRegularExpression> patterns_;
+};
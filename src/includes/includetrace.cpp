@@ -0,0 +1,79 @@
+#include "includetrace.h"
+
+Q_LOGGING_CATEGORY (includesLog, "qtc.utilities.includes")
+
+#ifdef INCLUDES_TRACING
+
+#  include <QElapsedTimer>
+#  include <QFile>
+#  include <QMutex>
+#  include <QThread>
+
+namespace {
+  class TraceLog {
+    public:
+      TraceLog () :
+        fileName_ (qEnvironmentVariable ("QTC_INCLUDES_TRACE_FILE")) {
+        timer_.start ();
+      }
+
+      ~TraceLog () {
+        if (fileName_.isEmpty ()) {
+          return;
+        }
+        QFile file (fileName_);
+        if (!file.open (QFile::WriteOnly)) {
+          qCWarning (includesLog) << "failed to write trace to" << fileName_;
+          return;
+        }
+        file.write ("{\"traceEvents\":[");
+        file.write (events_);
+        file.write ("]}\n");
+      }
+
+      bool isEnabled () const {
+        return !fileName_.isEmpty ();
+      }
+
+      qint64 now () const {
+        return timer_.nsecsElapsed () / 1000;
+      }
+
+      void add (const char *name, qint64 start, qint64 end) {
+        const auto event = QByteArray ("{\"name\":\"") + name
+                           + "\",\"ph\":\"X\",\"pid\":1,\"tid\":"
+                           + QByteArray::number (quintptr (QThread::currentThreadId ()))
+                           + ",\"ts\":" + QByteArray::number (start)
+                           + ",\"dur\":" + QByteArray::number (end - start) + '}';
+        QMutexLocker locker (&mutex_);
+        if (!events_.isEmpty ()) {
+          events_ += ",\n";
+        }
+        events_ += event;
+      }
+
+    private:
+      QString fileName_;
+      QElapsedTimer timer_;
+      QMutex mutex_;
+      QByteArray events_;
+  };
+
+  TraceLog &traceLog () {
+    static TraceLog log;
+    return log;
+  }
+}
+
+TraceScope::TraceScope (const char *name) :
+  name_ (name),
+  start_ (traceLog ().isEnabled () ? traceLog ().now () : -1) {
+}
+
+TraceScope::~TraceScope () {
+  if (start_ != -1) {
+    traceLog ().add (name_, start_, traceLog ().now ());
+  }
+}
+
+#endif
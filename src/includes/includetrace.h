@@ -0,0 +1,30 @@
+#pragma once
+
+#include <QLoggingCategory>
+
+Q_DECLARE_LOGGING_CATEGORY (includesLog)
+
+// Tracing of include analysis is compiled in only with INCLUDES_TRACING
+// (qmake CONFIG+=includes_tracing), otherwise trace statements are not
+// evaluated at all.
+// With tracing compiled in, messages go to the includesLog info level, which
+// release builds keep (they define QT_NO_DEBUG_OUTPUT), and,
+// if QTC_INCLUDES_TRACE_FILE is set, timed scopes are written there
+// in chrome trace event format (chrome://tracing).
+#ifdef INCLUDES_TRACING
+#  define INCLUDES_TRACE qCInfo (includesLog)
+#  define INCLUDES_TRACE_SCOPE(name) TraceScope traceScope (name)
+
+class TraceScope {
+  public:
+    explicit TraceScope (const char *name);
+    ~TraceScope ();
+
+  private:
+    const char *name_;
+    qint64 start_;
+};
+#else
+#  define INCLUDES_TRACE QT_NO_QDEBUG_MACRO ()
+#  define INCLUDES_TRACE_SCOPE(name)
+#endif
@@ -1,263 +1,202 @@
 #include "includetree.h"
+#include "includegraph.h"
+#include "setcover.h"
+#include "includetrace.h"
 
 #include <cplusplus/CppDocument.h>
+#include <cplusplus/Literals.h>
+#include <cplusplus/Symbol.h>
+#include <cplusplus/Symbols.h>
 
 #include <QSet>
-#include <QDebug>
 
-IncludeTreeNode::IncludeTreeNode (const QString &fileName) :
-  fileName_ (fileName) {
+#include <limits>
 
-}
+namespace {
+  const auto coverTimeBudgetMs = 100;
 
-void IncludeTreeNode::expand (const CPlusPlus::Snapshot &snapshot, IncludeRegistry &registry) {
-  //  qCritical () << "expand" << fileName_;
-  auto document = snapshot.document (fileName_);
-  if (!document) {
-    // TODO parse?
-    qCritical () << "no document for" << fileName_;
-    QFile file (fileName_);
-    weight_ = file.size ();
-    return;
+  // headers, which are not meant to be included directly
+  bool isPrivateHeader (const QString &fileName) {
+    static const QStringList parts {"/bits/", "/detail/", "/details/", "/private/",
+                                    "/internal/", "/impl/"};
+    for (const auto &part: parts) {
+      if (fileName.contains (part)) {
+        return true;
+      }
+    }
+    return fileName.endsWith (QLatin1String ("_p.h"));
   }
+}
 
-  if (!document->isParsed ()) {
-    qCritical () << "not parsed";
-    document->parse ();
-  }
-  if (!document->utf8Source ().isEmpty ()) {
-    qCritical () << "got source";
-    weight_ = document->utf8Source ().size ();
+bool isForwardDeclarable (CPlusPlus::Symbol *symbol) {
+  if (!symbol->asClass () && !symbol->asForwardClassDeclaration ()) {
+    return false;
   }
-  else {
-    QFile file (fileName_);
-    weight_ = file.size ();
-  }
-  //  qCritical () << fileName_ << "init weight" << weight_;
-
-  auto includes = document->includedFiles ();
-  includes.removeDuplicates ();
-  children_.reserve (includes.size ());
-
-  for (const auto &include: includes) {
-    if (!registry.contains (include)) {
-      auto &child = registry[include];
-      child.fileName_ = include;
-      //      qCritical () << fileName_ << "called expand for" << include;
-      child.expand (snapshot, registry);
+  for (auto scope = symbol->enclosingScope (); scope; scope = scope->enclosingScope ()) {
+    const auto ns = scope->asNamespace ();
+    if (!ns) {
+      return false;
+    }
+    if (!scope->enclosingScope ()) {
+      break; // global
+    }
+    // std must not be extended, unnamed and inline ones would declare another class
+    const auto id = ns->identifier ();
+    if (!id || id->size () == 0 || ns->isInline ()) {
+      return false;
+    }
+    if (!scope->enclosingScope ()->enclosingScope ()
+        && QByteArray::fromRawData (id->chars (), int (id->size ())) == "std") {
+      return false;
     }
-
-    auto child = &registry[include];
-    weight_ += child->weight ();
-    children_.append (child);
-    //    weight_ += child->weight ();
-
-    //    qCritical () << fileName_ << "weight with include" << include << weight_;
-    //    auto child = IncludeTreeNode (include);
-    //    child.expand (snapshot, registry);
-    //    weight_ += child.weight ();
-    //    children_.append (child);
-  }
-  //  std::copy (includes.cbegin (), includes.cend (), std::back_inserter (children_));
-  //  std::for_each (children_.begin (), children_.end (),
-  //                 [&snapshot](IncludeTreeNode &node) {
-  //    node.expand (snapshot);
-  //  });
-}
-
-//void IncludeTreeNode::addChild(const QString &fileName)
-//{
-//    if (!registry.contains (include)) {
-//        auto &child = registry[include];
-//        child.expand (snapshot, registry);
-//    }
-//}
-
-//void IncludeTreeNode::distribute (const QSet<CPlusPlus::Symbol *> &symbols) {
-//  QHash<QString, Symbols> symbolPerFile;
-//  for (const auto symbol: symbols) {
-//    symbolPerFile[QString::fromUtf8 (symbol->fileName ())].append (symbol);
-//  }
-
-//  distribute (symbolPerFile);
-//}
-
-//void IncludeTreeNode::appendNotDistributed (const QSet<CPlusPlus::Symbol *> &symbols,
-//                                            const CPlusPlus::Snapshot &snapshot) {
-//  QSet<QString> notDistributed;
-//  QHash<QString, Symbols> symbolPerFile;
-//  for (const auto symbol: symbols) {
-//    const auto fileName = QString::fromUtf8 (symbol->fileName ());
-//    symbolPerFile[fileName].append (symbol);
-//    notDistributed.insert (fileName);
-//  }
-//  filterWithChildren (notDistributed);
-
-//  for (const auto &file: notDistributed) {
-//    auto child = IncludeTreeNode (file);
-//    child.expand (snapshot);
-//    weight_ += child.weight ();
-//    children_.append (child);
-//  }
-//}
-
-//void IncludeTreeNode::removeEmptyPaths () {
-
-//}
-
-void IncludeTreeNode::distribute (const QHash<QString, Symbols> &symbolsPerFile) {
-  symbols_ = symbolsPerFile.value (fileName_);
-  for (auto child: children_) {
-    child->distribute (symbolsPerFile);
   }
+  return true;
 }
 
-void IncludeTreeNode::filterWithChildren (QSet<QString> &files) const {
-  files.remove (fileName_);
+IncludeTreeNode::IncludeTreeNode (const IncludeTree *tree, int index) :
+  tree_ (tree),
+  index_ (index) {
 
-  if (files.isEmpty ()) {
-    return;
-  }
+}
 
-  for (const auto child: children_) {
-    child->filterWithChildren (files);
-  }
+bool IncludeTreeNode::isValid () const {
+  return tree_ && index_ >= 0;
 }
 
 IncludeTreeNode::Symbols IncludeTreeNode::symbols () const {
-  return symbols_;
+  return tree_->symbols_[index_];
 }
 
 uint IncludeTreeNode::weight () const {
-  return weight_;
+  return uint (tree_->weight (index_).unique);
+}
+
+IncludeWeight IncludeTreeNode::weights () const {
+  return tree_->weight (index_);
 }
 
 const QString &IncludeTreeNode::fileName () const {
-  return fileName_;
+  return tree_->fileNames_[index_];
 }
 
 IncludeTreeNode::Symbols IncludeTreeNode::allSymbols () const {
-  QVector<QString> used; // infinite recursion protection
-  return allSymbols (used);
+  return tree_->allSymbols (index_);
 }
 
-QStringList IncludeTreeNode::allMacros () const {
-  QVector<QString> used; // infinite recursion protection
-  return allMacros (used);
+IncludeTreeNode::Macros IncludeTreeNode::allMacros () const {
+  return tree_->allMacros (index_);
 }
 
 bool IncludeTreeNode::hasChild (const QString &fileName) const {
-  for (const auto &child: children_) {
-    if (child->fileName_ == fileName || child->hasChild (fileName)) {
-      return true;
-    }
-  }
-  return false;
-}
-
-IncludeTreeNode::Symbols IncludeTreeNode::allSymbols (QVector<QString> &used) const {
-  if (used.contains (fileName_)) {
-    return {};
-  }
-
-  used.append (fileName_);
-
-  if (children_.isEmpty ()) {
-    return symbols_;
-  }
-
-  auto result = symbols_;
-  for (const auto child: children_) {
-    result += child->allSymbols (used);
-  }
-  //  auto result = std::accumulate (children_.cbegin (), children_.cend (), symbols_,
-  //                                 [](Symbols sum, const IncludeTreeNode *node) {
-  //    return sum + node->allSymbols ();
-  //  });
-  return result;
-}
-
-QStringList IncludeTreeNode::allMacros (QVector<QString> &used) const {
-  if (used.contains (fileName_)) {
-    return {};
-  }
-
-  used.append (fileName_);
-
-  if (children_.isEmpty ()) {
-    return macros_;
-  }
-
-  auto result = macros_;
-  for (const auto child: children_) {
-    result += child->allMacros (used);
-  }
-  return result;
+  const auto child = tree_->indexOf (fileName);
+  return child != -1 && tree_->hasChild (index_, child);
 }
 
-const QStringList &IncludeTreeNode::macros () const {
-  return macros_;
+const IncludeTreeNode::Macros &IncludeTreeNode::macros () const {
+  return tree_->macros_[index_];
 }
 
-IncludeTree::IncludeTree (const QString &fileName) :
-  root_ (fileName) {
+IncludeTree::IncludeTree (const QString &fileName, IncludeGraph &graph) :
+  graph_ (graph),
+  fileName_ (fileName) {
 
 }
 
 IncludeTreeNode IncludeTree::node (const QString &fileName) const {
-  return registry_[fileName];
+  return {this, indexOf (fileName)};
 }
 
 QStringList IncludeTree::includes () const {
   QStringList result;
+  result.reserve (includes_.size ());
 
-  auto &children = root_.children_;
-  result.reserve (children.size ());
-
-  std::transform (children.cbegin (), children.cend (), std::back_inserter (result),
-                  [](const IncludeTreeNode *node) {
-    return node->fileName ();
+  std::transform (includes_.cbegin (), includes_.cend (), std::back_inserter (result),
+                  [this](int index) {
+    return fileNames_[index];
   });
 
   return result;
 }
 
-uint IncludeTree::totalWeight (const QSet<QString> &files) const {
-  auto result = 0u;
+IncludeWeight IncludeTree::totalWeight (const QSet<QString> &files) const {
+  Bitset closure (fileIds_.size ());
+  for (const auto &i: files) {
+    const auto index = indexOf (i);
+    if (index != -1) {
+      closure.unite (this->closure (index));
+    }
+  }
+
+  auto result = weightOf (closure);
   for (const auto &i: files) {
-    result += registry_[i].weight ();
+    const auto index = indexOf (i);
+    if (index != -1) {
+      result.own += ownWeights_[index];
+      result.ownLines += ownLines_[index];
+    }
   }
   return result;
 }
 
 void IncludeTree::build (const CPlusPlus::Snapshot &snapshot) {
-  root_.expand (snapshot, registry_);
+  graph_.expand (fileName_, snapshot);
+
+  indexes_.clear ();
+  fileIds_.clear ();
+  fileNames_.clear ();
+  ownWeights_.clear ();
+  ownLines_.clear ();
+  offsets_.clear ();
+  edges_.clear ();
+  symbols_.clear ();
+  macros_.clear ();
+  macroIds_.clear ();
+
+  const auto root = attach ({graph_.id (fileName_)});
+  Q_ASSERT (root == 0);
+  includes_ = edges_.mid (offsets_[root], offsets_[root + 1] - offsets_[root]);
 }
 
 void IncludeTree::distribute (const Symbols &symbols) {
+  QHash<const CPlusPlus::StringLiteral *, int> indexPerFile;
   for (const auto symbol: symbols) {
-    const auto fileName = QString::fromUtf8 (symbol->fileName ());
-    if (!registry_.contains (fileName)) {
-      qCritical () << "not in registry" << fileName;
+    auto index = indexPerFile.value (symbol->fileId (), -2);
+    if (index == -2) {
+      index = indexOf (QString::fromUtf8 (symbol->fileName ()));
+      indexPerFile.insert (symbol->fileId (), index);
+    }
+    if (index == -1) {
+      INCLUDES_TRACE << "not in registry" << symbol->fileName ();
       continue;
     }
 
-    auto &node = registry_[fileName];
-    node.symbols_.append (symbol);
+    symbols_[index].append (symbol);
   }
 }
 
 void IncludeTree::distribute (const QList<CPlusPlus::Document::MacroUse> &macros) {
-  for (const auto &macro: macros) {
-    const auto fileName = macro.macro ().fileName ();
-    if (!registry_.contains (fileName)) {
-      qCritical () << "not in registry" << fileName
-                   << "macro" << macro.macro ().nameToQString ();
+  QHash<QString, int> indexPerFile;
+  for (const auto &use: macros) {
+    const auto &macro = use.macro ();
+    auto index = indexPerFile.value (macro.fileName (), -2);
+    if (index == -2) {
+      index = indexOf (macro.fileName ());
+      indexPerFile.insert (macro.fileName (), index);
+    }
+    if (index == -1) {
+      INCLUDES_TRACE << "not in registry" << macro.fileName ()
+                     << "macro" << macro.nameToQString ();
       continue;
     }
 
-    auto &node = registry_[fileName];
-    node.macros_.append (macro.macro ().toString ());
+    // every use of a macro, defined in a file, adds it there once
+    const auto key = qMakePair (macro.name (), (quint64 (index) << 32) | macro.line ());
+    if (macroIds_.contains (key)) {
+      continue;
+    }
+    const auto id = macroIds_.size ();
+    macroIds_.insert (key, id);
+    macros_[index].append (id);
   }
 }
 
@@ -265,106 +204,381 @@ void IncludeTree::addNew (const IncludeTree::Symbols &symbols,
                           const CPlusPlus::Snapshot &snapshot) {
   for (const auto symbol: symbols) {
     const auto fileName = QString::fromUtf8 (symbol->fileName ());
-    if (registry_.contains (fileName)) {
+    auto index = indexOf (fileName);
+    if (index != -1) {
       continue;
     }
-    auto &child = registry_[fileName];
-    child.expand (snapshot, registry_);
-    child.symbols_.append (symbol);
-    root_.children_.append (&child);
-    root_.weight_ += child.weight ();
+    graph_.expand (fileName, snapshot);
+    index = attach ({graph_.id (fileName)});
+    symbols_[index].append (symbol);
+    includes_.append (index);
   }
 }
 
 void IncludeTree::removeEmptyPaths () {
-  auto &children = root_.children_;
-  children.erase (std::remove_if (children.begin (), children.end (),
-                                  [](const IncludeTreeNode *node) {
-    return node->allSymbols ().isEmpty () && node->allMacros ().isEmpty ();
-  }), children.end ());
+  Bitset used (fileIds_.size ());
+  for (auto i = 0, end = fileIds_.size (); i < end; ++i) {
+    if (!symbols_[i].isEmpty () || !macros_[i].isEmpty ()) {
+      used.set (i);
+    }
+  }
+
+  includes_.erase (std::remove_if (includes_.begin (), includes_.end (),
+                                   [this, &used](int index) {
+    return !componentClosure (index).intersects (used);
+  }), includes_.end ());
 }
 
 void IncludeTree::removeNestedPaths () {
-  using Nodes = QVector<const IncludeTreeNode *>;
-  const auto allMacros = root_.allMacros ();
-  QHash<const void *, Nodes> nodePerEntity;
-  auto &children = root_.children_;
-
-  const auto macroPointer = [&allMacros](const QString &macro) {
-                              Q_ASSERT (allMacros.contains (macro));
-                              return &allMacros[allMacros.indexOf (macro)];
-                            };
-
-  for (const auto child: children) {
-    for (const auto symbol: child->allSymbols ()) {
-      nodePerEntity[symbol].append (child);
+  INCLUDES_TRACE_SCOPE ("IncludeTree::removeNestedPaths");
+  // macro ids are entities as is, symbols are numbered after them
+  const auto macroCount = macroIds_.size ();
+  QHash<const void *, int> symbolIds;
+  QVector<QVector<int> > entitiesPerChild;
+  entitiesPerChild.reserve (includes_.size ());
+
+  for (const auto child: includes_) {
+    auto entities = allMacros (child);
+    for (const auto symbol: allSymbols (child)) {
+      auto id = symbolIds.value (symbol, -1);
+      if (id == -1) {
+        id = macroCount + symbolIds.size ();
+        symbolIds.insert (symbol, id);
+      }
+      entities.append (id);
+    }
+    entitiesPerChild.append (entities);
+  }
+
+  SetCover cover (macroCount + symbolIds.size ());
+  for (auto i = 0, end = includes_.size (); i < end; ++i) {
+    cover.addSet (entitiesPerChild[i], weight (includes_[i]).unique);
+  }
+  const auto chosen = cover.solve (coverTimeBudgetMs);
+
+  Indexes used;
+  for (auto i = 0, end = includes_.size (); i < end; ++i) {
+    if (chosen.contains (i)) {
+      used.append (includes_[i]);
+    }
+  }
+  includes_ = used;
+}
+
+QStringList IncludeTree::missingIncludes () const {
+  const auto size = fileIds_.size ();
+  const auto reachable = closure (0);
+
+  // files reachable through kept includes are already provided by them
+  Bitset provided (size);
+  for (const auto child: includes_) {
+    provided.unite (componentClosure (child));
+  }
+
+  // files used only through other includes get the lightest public header,
+  // that includes them (often the file itself)
+  QStringList result;
+  for (auto file = 1; file < size; ++file) {
+    if (provided.test (file) || symbols_[file].isEmpty () || !reachable.test (file)) {
+      continue;
+    }
+
+    auto best = -1;
+    auto bestWeight = std::numeric_limits<quint64>::max ();
+    for (auto candidate = 1; candidate < size; ++candidate) {
+      if (!reachable.test (candidate) || !componentClosure (candidate).test (file)
+          || isPrivateHeader (fileNames_[candidate])) {
+        continue;
+      }
+      const auto weight = componentWeight (candidate).unique;
+      if (weight < bestWeight || (weight == bestWeight && candidate == file)) {
+        best = candidate;
+        bestWeight = weight;
+      }
     }
-    for (const auto macro: child->allMacros ()) {
-      nodePerEntity[macroPointer (macro)].append (child);
+
+    if (best == -1) {
+      continue;
     }
+    provided.unite (componentClosure (best));
+    result.append (fileNames_[best]);
   }
+  return result;
+}
 
-  const auto compareNodeWeight = [](const IncludeTreeNode *l, const IncludeTreeNode *r) {
-                                   Q_ASSERT (l && r);
-                                   return l->weight () < r->weight ();
-                                 };
-  const auto compareNodeCount = [](const Nodes &l, const Nodes &r) {
-                                  return l.size () < r.size ();
-                                };
-
-  QVector<const IncludeTreeNode *> usedNodes;
-  while (!nodePerEntity.isEmpty ()) {
-    auto unique = std::find_if (nodePerEntity.cbegin (), nodePerEntity.cend (),
-                                [](const QVector<const IncludeTreeNode *> &list) {
-      return list.size () == 1;
-    });
-    if (unique != nodePerEntity.cend ()) {
-      const auto uniqueNode = unique.value ().first ();
-      usedNodes.append (uniqueNode);
-      for (auto symbol: uniqueNode->allSymbols ()) {
-        nodePerEntity.remove (symbol);
+QVector<ForwardDeclarable> IncludeTree::forwardDeclarable (const Symbols &completeUses) const {
+  const auto size = fileIds_.size ();
+  QVector<ForwardDeclarable> result;
+  auto remaining = includes_;
+
+  // greedy: replace the include saving most, while others still provide
+  // everything used, that it does not
+  while (true) {
+    Bitset all (size);
+    for (const auto include: remaining) {
+      all.unite (componentClosure (include));
+    }
+    const auto allWeight = weightOf (all).unique;
+
+    auto best = -1;
+    ForwardDeclarable bestResult;
+    for (const auto include: remaining) {
+      Bitset others (size);
+      for (const auto other: remaining) {
+        if (other != include) {
+          others.unite (componentClosure (other));
+        }
       }
-      for (auto macro: uniqueNode->allMacros ()) {
-        nodePerEntity.remove (macroPointer (macro));
+      auto exclusive = componentClosure (include);
+      exclusive.subtract (others);
+
+      ForwardDeclarable candidate;
+      auto isDeclarable = true;
+      exclusive.forEach ([&](int file) {
+        isDeclarable = isDeclarable && macros_[file].isEmpty ();
+        for (const auto symbol: symbols_[file]) {
+          isDeclarable = isDeclarable && !completeUses.contains (symbol)
+                         && isForwardDeclarable (symbol);
+          candidate.classes.append (symbol);
+        }
+      });
+      if (!isDeclarable || candidate.classes.isEmpty ()) {
+        continue;
+      }
+
+      candidate.fileName = fileNames_[include];
+      candidate.savedWeight = allWeight - weightOf (others).unique;
+      if (best == -1 || candidate.savedWeight > bestResult.savedWeight) {
+        best = include;
+        bestResult = candidate;
       }
+    }
+
+    if (best == -1) {
+      break;
+    }
+    result.append (bestResult);
+    remaining.removeOne (best);
+  }
+  return result;
+}
+
+IncludeTreeNode IncludeTree::root () const {
+  return {this, 0};
+}
+
+int IncludeTree::attach (const QVector<int> &fileIds) {
+  hasClosures_ = false;
+  const auto subgraph = graph_.subgraph (fileIds);
+  const auto firstNew = fileIds_.size ();
+
+  QVector<int> mapping (subgraph.size ());
+  for (auto node = 0; node < subgraph.size (); ++node) {
+    const auto fileId = subgraph.files[node];
+    const auto it = indexes_.constFind (fileId);
+    if (it != indexes_.cend ()) {
+      mapping[node] = it.value ();
       continue;
     }
+    const auto index = fileIds_.size ();
+    mapping[node] = index;
+    indexes_.insert (fileId, index);
+    fileIds_.append (fileId);
+    fileNames_.append (subgraph.paths[node]);
+    ownWeights_.append (subgraph.ownWeights[node]);
+    ownLines_.append (subgraph.ownLines[node]);
+    symbols_.append ({});
+    macros_.append ({});
+  }
 
-    const auto minVariable = std::min_element (nodePerEntity.cbegin (), nodePerEntity.cend (),
-                                               compareNodeCount);
-    Q_ASSERT (minVariable != nodePerEntity.cend ());
+  if (offsets_.isEmpty ()) {
+    offsets_.append (0);
+  }
+  for (auto node = 0; node < subgraph.size (); ++node) {
+    if (mapping[node] < firstNew) {
+      continue;
+    }
+    for (auto edge = subgraph.offsets[node]; edge < subgraph.offsets[node + 1]; ++edge) {
+      edges_.append (mapping[subgraph.edges[edge]]);
+    }
+    offsets_.append (edges_.size ());
+  }
+
+  return mapping.isEmpty () ? -1 : mapping.first ();
+}
 
-    const auto symbolNodes = minVariable.value ();
-    Q_ASSERT (!symbolNodes.isEmpty ());
+int IncludeTree::indexOf (const QString &fileName) const {
+  return indexes_.value (graph_.id (fileName), -1);
+}
 
-    const auto min = std::min_element (symbolNodes.cbegin (), symbolNodes.cend (),
-                                       compareNodeWeight);
-    Q_ASSERT (min != symbolNodes.cend ());
+template <typename Function>
+void IncludeTree::forEachChild (int index, Function function) const {
+  if (index == 0) {
+    for (const auto child: includes_) {
+      function (child);
+    }
+    return;
+  }
+  for (auto edge = offsets_[index], end = offsets_[index + 1]; edge < end; ++edge) {
+    function (edges_[edge]);
+  }
+}
 
-    const auto minNode = *min;
-    usedNodes.append (minNode);
-    for (auto symbol: minNode->allSymbols ()) {
-      nodePerEntity.remove (symbol);
+void IncludeTree::computeClosures () const {
+  INCLUDES_TRACE_SCOPE ("IncludeTree::computeClosures");
+  const auto size = fileIds_.size ();
+  components_.fill (-1, size);
+  closures_.clear ();
+
+  // iterative Tarjan, components are found in reverse topological order,
+  // so closures of all included components are ready when one is completed
+  QVector<int> order (size, -1);
+  QVector<int> low (size);
+  QVector<bool> onStack (size);
+  Indexes stack;
+  QVector<QPair<int, int> > calls; // node, next edge
+  auto counter = 0;
+
+  const auto enter = [&](int node) {
+                       order[node] = low[node] = counter++;
+                       stack.append (node);
+                       onStack[node] = true;
+                       calls.append ({node, offsets_[node]});
+                     };
+
+  for (auto start = 0; start < size; ++start) {
+    if (order[start] != -1) {
+      continue;
     }
-    for (auto macro: minNode->allMacros ()) {
-      nodePerEntity.remove (macroPointer (macro));
+    enter (start);
+
+    while (!calls.isEmpty ()) {
+      const auto node = calls.last ().first;
+      const auto edge = calls.last ().second;
+      if (edge < offsets_[node + 1]) {
+        ++calls.last ().second;
+        const auto child = edges_[edge];
+        if (order[child] == -1) {
+          enter (child);
+        }
+        else if (onStack[child]) {
+          low[node] = std::min (low[node], order[child]);
+        }
+        continue;
+      }
+
+      calls.removeLast ();
+      if (!calls.isEmpty ()) {
+        const auto parent = calls.last ().first;
+        low[parent] = std::min (low[parent], low[node]);
+      }
+      if (low[node] != order[node]) {
+        continue;
+      }
+
+      const auto component = closures_.size ();
+      Bitset closure (size);
+      Indexes members;
+      auto member = -1;
+      do {
+        member = stack.takeLast ();
+        onStack[member] = false;
+        components_[member] = component;
+        closure.set (member);
+        members.append (member);
+      } while (member != node);
+
+      for (const auto i: members) {
+        for (auto e = offsets_[i], end = offsets_[i + 1]; e < end; ++e) {
+          const auto target = components_[edges_[e]];
+          if (target != component) {
+            closure.unite (closures_[target]);
+          }
+        }
+      }
+      closures_.append (closure);
     }
   }
 
-  children.erase (std::remove_if (children.begin (), children.end (),
-                                  [usedNodes](const IncludeTreeNode *node) {
-    return !usedNodes.contains (node);
-  }), children.end ());
+  closureWeights_.clear ();
+  closureWeights_.reserve (closures_.size ());
+  for (const auto &closure: closures_) {
+    closureWeights_.append (weightOf (closure));
+  }
+
+  hasClosures_ = true;
+}
+
+const Bitset &IncludeTree::componentClosure (int index) const {
+  if (!hasClosures_) {
+    computeClosures ();
+  }
+  return closures_[components_[index]];
+}
+
+const IncludeWeight &IncludeTree::componentWeight (int index) const {
+  if (!hasClosures_) {
+    computeClosures ();
+  }
+  return closureWeights_[components_[index]];
+}
+
+Bitset IncludeTree::closure (int index) const {
+  if (index != 0) {
+    return componentClosure (index);
+  }
+
+  // root children are modified during reduction
+  Bitset result (fileIds_.size ());
+  result.set (0);
+  for (const auto child: includes_) {
+    result.unite (componentClosure (child));
+  }
+  return result;
+}
+
+IncludeWeight IncludeTree::weightOf (const Bitset &closure) const {
+  IncludeWeight result;
+  closure.forEach ([this, &result](int i) {
+    result.unique += ownWeights_[i];
+    result.uniqueLines += ownLines_[i];
+  });
+  return result;
+}
+
+IncludeWeight IncludeTree::weight (int index) const {
+  auto result = index != 0 ? componentWeight (index) : weightOf (closure (index));
+  result.own = ownWeights_[index];
+  result.ownLines = ownLines_[index];
+  return result;
+}
+
+bool IncludeTree::hasChild (int index, int child) const {
+  auto result = false;
+  forEachChild (index, [this, child, &result](int i) {
+    result = result || componentClosure (i).test (child);
+  });
+  return result;
+}
+
+void IncludeTree::filterWithChildren (int index, QSet<QString> &files) const {
+  closure (index).forEach ([this, &files](int i) {
+    files.remove (fileNames_[i]);
+  });
 }
 
-//void IncludeTree::appendNotDistributed (const QSet<CPlusPlus::Symbol *> &symbols,
-//                                        const CPlusPlus::Snapshot &snapshot) {
-//  QHash<QString, IncludeTreeNode::Symbols> symbolPerFile;
-//  for (const auto symbol: symbols) {
-//    symbolPerFile[QString::fromUtf8 (symbol->fileName ())].append (symbol);
-//  }
-//}
+IncludeTreeNode::Symbols IncludeTree::allSymbols (int index) const {
+  IncludeTreeNode::Symbols result;
+  closure (index).forEach ([this, &result](int i) {
+    result += symbols_[i];
+  });
+  return result;
+}
 
-const IncludeTreeNode &IncludeTree::root () const {
-  return root_;
+IncludeTreeNode::Macros IncludeTree::allMacros (int index) const {
+  IncludeTreeNode::Macros result;
+  closure (index).forEach ([this, &result](int i) {
+    result += macros_[i];
+  });
+  return result;
 }
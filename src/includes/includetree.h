@@ -1,5 +1,7 @@
 #pragma once
 
+#include "bitset.h"
+
 #include <QVector>
 #include <QHash>
 
@@ -9,50 +11,64 @@ namespace CPlusPlus {
   class Symbol;
   class Snapshot;
 }
-class IncludeTreeNode;
-using IncludeRegistry = QHash<QString, IncludeTreeNode>;
+class IncludeGraph;
+class IncludeTree;
+
+// Parse cost of a set of files. Unique values count every file of the
+// set and of its transitive includes once, as the compiler reads them.
+struct IncludeWeight {
+  quint64 own = 0u;
+  quint64 unique = 0u;
+  quint64 ownLines = 0u;
+  quint64 uniqueLines = 0u;
+};
+
+// Include, that can be replaced with forward declarations of classes.
+struct ForwardDeclarable {
+  QString fileName;
+  QVector<CPlusPlus::Symbol *> classes;
+  quint64 savedWeight = 0u; // unique
+};
+
+// Non template class of named namespaces, which may be declared outside of them.
+bool isForwardDeclarable (CPlusPlus::Symbol *symbol);
 
+// Lightweight handle to a node of IncludeTree. Valid while the tree lives.
 class IncludeTreeNode {
   public:
     using Symbols = QVector<CPlusPlus::Symbol *>;
-    IncludeTreeNode (const QString &fileName = {
-  });
-    //    void distribute (const QSet<CPlusPlus::Symbol *> &symbols);
+    using Macros = QVector<int>; // ids interned by the tree
 
-    uint weight () const;
+    bool isValid () const;
+    uint weight () const; // unique
+    IncludeWeight weights () const;
     const QString &fileName () const;
     Symbols allSymbols () const;
-    QStringList allMacros () const;
+    Macros allMacros () const;
     bool hasChild (const QString &fileName) const;
 
     Symbols symbols () const;
-    const QStringList &macros () const;
+    const Macros &macros () const;
 
   private:
     friend class IncludeTree;
-    //    void addChild (const QString &fileName);
-    void expand (const CPlusPlus::Snapshot &snapshot,
-                 IncludeRegistry &registry);
-    void distribute (const QHash<QString, Symbols > &symbolsPerFile);
-    void filterWithChildren (QSet<QString> &files) const;
-    Symbols allSymbols (QVector<QString> &used) const;
-    QStringList allMacros (QVector<QString> &used) const;
-
-    uint weight_ = 0u;
-    QString fileName_;
-    Symbols symbols_;
-    QStringList macros_;
-    QVector<IncludeTreeNode *> children_;
+    IncludeTreeNode (const IncludeTree *tree, int index);
+
+    const IncludeTree *tree_;
+    int index_;
 };
 
+// Include tree of a single document.
+// Nodes are indexed densely (root is 0), edges are stored in CSR form.
+// Reachability is answered from per component closure bitsets.
 class IncludeTree {
   public:
     using Symbols = QSet<CPlusPlus::Symbol *>;
-    explicit IncludeTree (const QString &fileName);
+    IncludeTree (const QString &fileName, IncludeGraph &graph);
 
     IncludeTreeNode node (const QString &fileName) const;
     QStringList includes () const;
-    uint totalWeight (const QSet<QString> &files) const;
+    IncludeWeight totalWeight (const QSet<QString> &files) const;
 
     void build (const CPlusPlus::Snapshot &snapshot);
     void distribute (const Symbols &symbols);
@@ -60,11 +76,49 @@ class IncludeTree {
     void addNew (const Symbols &symbols, const CPlusPlus::Snapshot &snapshot);
     void removeEmptyPaths ();
     void removeNestedPaths ();
+    QStringList missingIncludes () const;
+    QVector<ForwardDeclarable> forwardDeclarable (const Symbols &completeUses) const;
 
-    const IncludeTreeNode &root () const;
+    IncludeTreeNode root () const;
 
   private:
-    IncludeRegistry registry_;
-    IncludeTreeNode root_;
-};
+    friend class IncludeTreeNode;
+    using Indexes = QVector<int>;
+
+    int attach (const QVector<int> &fileIds);
+    int indexOf (const QString &fileName) const;
+    template <typename Function>
+    void forEachChild (int index, Function function) const;
+    void computeClosures () const;
+    const Bitset &componentClosure (int index) const;
+    const IncludeWeight &componentWeight (int index) const;
+    Bitset closure (int index) const;
+    IncludeWeight weightOf (const Bitset &closure) const;
+    IncludeWeight weight (int index) const;
+    bool hasChild (int index, int child) const;
+    void filterWithChildren (int index, QSet<QString> &files) const;
+    IncludeTreeNode::Symbols allSymbols (int index) const;
+    IncludeTreeNode::Macros allMacros (int index) const;
+
+    IncludeGraph &graph_;
+    QString fileName_;
 
+    QHash<int, int> indexes_; // file id -> index
+    QVector<int> fileIds_;
+    QVector<QString> fileNames_;
+    QVector<uint> ownWeights_;
+    QVector<uint> ownLines_;
+    QVector<int> offsets_;
+    QVector<int> edges_;
+    Indexes includes_; // current root children
+
+    QVector<IncludeTreeNode::Symbols> symbols_;
+    QVector<IncludeTreeNode::Macros> macros_;
+    QHash<QPair<QByteArray, quint64>, int> macroIds_; // name, file index and line -> id
+
+    // transitive closures, computed once per build
+    mutable bool hasClosures_ = false;
+    mutable QVector<int> components_; // index -> strongly connected component
+    mutable QVector<Bitset> closures_; // component -> reachable indexes
+    mutable QVector<IncludeWeight> closureWeights_; // component -> weight of closure
+};
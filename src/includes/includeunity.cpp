@@ -0,0 +1,185 @@
+#include "includeunity.h"
+#include "bitset.h"
+#include "includegraph.h"
+#include "includetrace.h"
+
+#include <QHash>
+#include <QSet>
+
+#include <algorithm>
+#include <limits>
+
+namespace {
+  const auto sketchSize = 64; // bins of one permutation hashing
+  const auto bandRows = 4;
+  const auto bucketNeighbours = 8; // pairs per unit in a bucket, limits identical closures
+  const auto minSimilarity = 0.5;
+  const auto unitsPerGroup = 8;
+  const auto emptyBin = std::numeric_limits<quint32>::max ();
+
+  quint64 mix (quint64 value) {
+    value += 0x9e3779b97f4a7c15ull;
+    value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ull;
+    value = (value ^ (value >> 27)) * 0x94d049bb133111ebull;
+    return value ^ (value >> 31);
+  }
+
+  QVector<quint32> sketch (const Bitset &closure) {
+    QVector<quint32> result (sketchSize, emptyBin);
+    closure.forEach ([&result](int node) {
+      const auto hash = mix (quint64 (node));
+      auto &bin = result[int (hash % sketchSize)];
+      bin = std::min (bin, quint32 (hash >> 32));
+    });
+    return result;
+  }
+
+  double similarity (const Bitset &l, const Bitset &r) {
+    const auto common = l.intersectionCount (r);
+    const auto all = l.count () + r.count () - common;
+    return all > 0 ? double (common) / all : 0.;
+  }
+
+  quint64 weight (const Bitset &nodes, const IncludeSubgraph &graph) {
+    auto result = quint64 (0);
+    nodes.forEach ([&result, &graph](int node) {
+      result += graph.ownWeights[node];
+    });
+    return result;
+  }
+
+  int find (QVector<int> &parents, int node) {
+    while (parents[node] != node) {
+      parents[node] = parents[parents[node]];
+      node = parents[node];
+    }
+    return node;
+  }
+}
+
+QVector<UnityGroup> proposeUnityGroups (const IncludeSubgraph &graph, int maxGroupSize) {
+  INCLUDES_TRACE_SCOPE ("proposeUnityGroups");
+  const auto size = graph.size ();
+  QVector<int> units;
+  for (auto node = 0; node < size; ++node) {
+    if (graph.isUnit[node]) {
+      units.append (node);
+    }
+  }
+  const auto count = units.size ();
+
+  QVector<Bitset> closures;
+  QVector<quint64> weights;
+  QVector<QVector<quint32> > sketches;
+  closures.reserve (count);
+  QVector<int> queue;
+  for (const auto unit: units) {
+    Bitset closure (size);
+    closure.set (unit);
+    queue = {unit};
+    while (!queue.isEmpty ()) {
+      const auto node = queue.takeLast ();
+      for (auto edge = graph.offsets[node], end = graph.offsets[node + 1]; edge < end; ++edge) {
+        const auto target = graph.edges[edge];
+        if (!closure.test (target)) {
+          closure.set (target);
+          queue.append (target);
+        }
+      }
+    }
+    weights.append (weight (closure, graph));
+    sketches.append (sketch (closure));
+    closures.append (closure);
+  }
+
+  // units with equal band of sketch are likely similar
+  QSet<quint64> pairs;
+  for (auto band = 0; band < sketchSize; band += bandRows) {
+    QHash<quint64, QVector<int> > buckets;
+    for (auto i = 0; i < count; ++i) {
+      auto key = quint64 (0);
+      auto isEmpty = true;
+      for (auto row = band; row < band + bandRows; ++row) {
+        key = mix (key ^ sketches[i][row]);
+        isEmpty = isEmpty && sketches[i][row] == emptyBin;
+      }
+      if (!isEmpty) {
+        buckets[key].append (i);
+      }
+    }
+    for (const auto &bucket: buckets) {
+      for (auto i = 0, end = bucket.size (); i < end; ++i) {
+        for (auto j = i + 1; j < std::min (end, i + 1 + bucketNeighbours); ++j) {
+          pairs.insert ((quint64 (bucket[i]) << 32) | quint64 (bucket[j]));
+        }
+      }
+    }
+  }
+
+  struct Pair {
+    double similarity;
+    int first;
+    int second;
+  };
+  QVector<Pair> candidates;
+  for (const auto pair: pairs) {
+    const auto first = int (pair >> 32);
+    const auto second = int (pair & 0xffffffffu);
+    const auto value = similarity (closures[first], closures[second]);
+    if (value >= minSimilarity) {
+      candidates.append ({value, first, second});
+    }
+  }
+  std::sort (candidates.begin (), candidates.end (), [](const Pair &l, const Pair &r) {
+    return l.similarity > r.similarity;
+  });
+
+  // closure of root becomes closure of the whole group
+  QVector<int> parents (count);
+  QVector<QVector<int> > members (count);
+  for (auto i = 0; i < count; ++i) {
+    parents[i] = i;
+    members[i] = {i};
+  }
+  for (const auto &pair: candidates) {
+    const auto first = find (parents, pair.first);
+    const auto second = find (parents, pair.second);
+    if (first == second || members[first].size () + members[second].size () > maxGroupSize
+        || similarity (closures[first], closures[second]) < minSimilarity) {
+      continue;
+    }
+    closures[first].unite (closures[second]);
+    members[first] += members[second];
+    members[second].clear ();
+    parents[second] = first;
+  }
+
+  QVector<UnityGroup> result;
+  for (auto i = 0; i < count; ++i) {
+    if (members[i].size () < 2) {
+      continue;
+    }
+    UnityGroup group;
+    for (const auto member: members[i]) {
+      group.files.append (graph.paths[units[member]]);
+      group.parsed += weights[member];
+    }
+    group.merged = weight (closures[i], graph);
+    result.append (group);
+  }
+  std::sort (result.begin (), result.end (), [](const UnityGroup &l, const UnityGroup &r) {
+    return l.parsed - l.merged > r.parsed - r.merged;
+  });
+  return result;
+}
+
+QVector<UnityGroup> unityGroups (const CPlusPlus::Snapshot &snapshot, const QStringList &files,
+                                 QSharedPointer<IncludeGraph> graph) {
+  graph->expand (files, snapshot);
+  QVector<int> roots;
+  roots.reserve (files.size ());
+  for (const auto &file: files) {
+    roots.append (graph->id (file));
+  }
+  return proposeUnityGroups (graph->subgraph (roots), unitsPerGroup);
+}
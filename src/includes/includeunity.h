@@ -0,0 +1,28 @@
+#pragma once
+
+#include <QSharedPointer>
+#include <QStringList>
+
+namespace CPlusPlus {
+  class Snapshot;
+}
+
+class IncludeGraph;
+struct IncludeSubgraph;
+
+struct UnityGroup {
+  QStringList files;
+  quint64 parsed = 0u; // weights of units compiled separately
+  quint64 merged = 0u; // weight of the unity unit
+};
+
+// Groups units with similar include closures, so shared headers are parsed
+// once per group. Candidate pairs come from banded MinHash sketches of
+// closures, they are merged by exact Jaccard similarity of closure bitsets,
+// most similar first, while groups are not larger than maxGroupSize.
+// Groups of several units are returned, most saving first.
+QVector<UnityGroup> proposeUnityGroups (const IncludeSubgraph &graph, int maxGroupSize);
+
+// Expands the graph from files and groups its units.
+QVector<UnityGroup> unityGroups (const CPlusPlus::Snapshot &snapshot, const QStringList &files,
+                                 QSharedPointer<IncludeGraph> graph);
@@ -2,14 +2,32 @@
 #include "includeextractor.h"
 #include "includetree.h"
 #include "includemodifier.h"
+#include "includeorganizer.h"
+#include "includebatch.h"
+#include "includeannotations.h"
+#include "includecycles.h"
+#include "includefanout.h"
+#include "includepch.h"
+#include "includeunity.h"
+#include "includereportpane.h"
+#include "includeoptionspage.h"
+#include "includesorter.h"
 
 #include <coreplugin/actionmanager/actionmanager.h>
 #include <coreplugin/actionmanager/actioncontainer.h>
 #include <coreplugin/editormanager/editormanager.h>
+#include <coreplugin/icore.h>
+#include <coreplugin/messagemanager.h>
+#include <coreplugin/progressmanager/progressmanager.h>
 
 #include <extensionsystem/iplugin.h>
 
+#include <projectexplorer/project.h>
+#include <projectexplorer/projectnodes.h>
+#include <projectexplorer/projecttree.h>
+
 #include <cpptools/cppmodelmanager.h>
+#include <cpptools/cpptoolsconstants.h>
 #include <cpptools/projectpart.h>
 #include <cpptools/includeutils.h>
 
@@ -23,10 +41,17 @@
 #include "texteditor/textmark.h"
 #include "texteditor/textdocument.h"
 #include <utils/executeondestruction.h>
+#include <utils/runextensions.h>
 
 #include <QMenu>
 #include <QDir>
 #include <QTextBlock>
+#include <QFutureWatcher>
+#include <QPointer>
+#include <QFileDialog>
+#include <QFileInfo>
+#include <QStandardItem>
+#include <QtConcurrent>
 
 namespace QtcUtilities {
   namespace Internal {
@@ -40,70 +65,139 @@ namespace QtcUtilities {
         const char ACTION_REMOVE_INCLUDES[] = "IncludeUtils.RemoveIncludes";
         const char ACTION_RESOLVE_INCLUDES[] = "IncludeUtils.ResolveIncludes";
         const char ACTION_RENAME_INCLUDES[] = "IncludeUtils.RenameIncludes";
-        const char OPTIONS_PAGE_ID[] = "IncludeUtils.OptionaPageId";
-        const char OPTIONS_CATEGORY_ID[] = "QtcUtilities.CategoryId";
-        const char OPTIONS_CATEGORY_ICON[] = ":/resources/section.png";
-      }
+        const char ACTION_ORGANIZE_PROJECT_INCLUDES[] = "IncludeUtils.OrganizeProjectIncludes";
+        const char ACTION_FORWARD_DECLARE[] = "IncludeUtils.ForwardDeclare";
+        const char ACTION_SORT_PROJECT_INCLUDES[] = "IncludeUtils.SortProjectIncludes";
+        const char ACTION_FIND_INCLUDE_CYCLES[] = "IncludeUtils.FindIncludeCycles";
+        const char ACTION_SHOW_FAN_OUT[] = "IncludeUtils.ShowFanOut";
+        const char ACTION_PROPOSE_PCH[] = "IncludeUtils.ProposePch";
+        const char ACTION_PROPOSE_UNITY[] = "IncludeUtils.ProposeUnity";
+        const char TASK_ORGANIZE_INCLUDES[] = "IncludeUtils.Organize";
+        const char TASK_ORGANIZE_PROJECT_INCLUDES[] = "IncludeUtils.OrganizeProject";
+        const char TASK_INDEX_SYMBOLS[] = "IncludeUtils.IndexSymbols";
+        const char TASK_SORT_PROJECT_INCLUDES[] = "IncludeUtils.SortProject";
+        const char TASK_FIND_INCLUDE_CYCLES[] = "IncludeUtils.FindCycles";
+        const char TASK_FIND_FAN_OUT[] = "IncludeUtils.FindFanOut";
+        const char TASK_PROPOSE_PCH[] = "IncludeUtils.ProposePch";
+        const char TASK_PROPOSE_UNITY[] = "IncludeUtils.ProposeUnity";
+        const char TASK_EXPAND_GRAPH[] = "IncludeUtils.ExpandGraph";
+
+        // sources of the project, limited to selected folder if any
+        QStringList projectFiles (ProjectExplorer::Project *project, bool withHeaders) {
+          using namespace CppTools;
+          using namespace ProjectExplorer;
+
+          QString scope;
+          if (auto node = ProjectTree::currentNode ()) {
+            if (node->asFolderNode ()) {
+              scope = node->filePath ().toString () + QLatin1Char ('/');
+            }
+          }
 
-      class WeightHoverHandle : public TextEditor::BaseHoverHandler {
-        void identifyMatch (TextEditor::TextEditorWidget *editorWidget, int pos,
-                            ReportPriority report) override {
-          Utils::ExecuteOnDestruction reportPriority ([this, report]() {
-            report (priority ());
-          });
+          auto model = CppModelManager::instance ();
+          QStringList files;
+          for (const auto &part: model->projectInfo (project).projectParts ()) {
+            for (const auto &file: part->files) {
+              if ((ProjectFile::isSource (file.kind)
+                   || (withHeaders && ProjectFile::isHeader (file.kind)))
+                  && (scope.isEmpty () || file.path.startsWith (scope))) {
+                files.append (file.path);
+              }
+            }
+          }
+          files.removeDuplicates ();
+          return files;
+        }
 
-          auto doc = editorWidget->textDocument ();
-          auto block = doc->document ()->findBlock (pos);
-          //          qCritical () << block.text ()
-          //                    << doc->filePath ();
-          if (!block.text ().startsWith ("#include")) {
+        void saveText (const QString &text, const QString &caption, const QString &fileName,
+                       const QString &filter) {
+          using namespace Core;
+          const auto selected = QFileDialog::getSaveFileName (ICore::dialogParent (), caption,
+                                                              fileName, filter);
+          if (selected.isEmpty ()) {
             return;
           }
 
-          const auto line = block.firstLineNumber () + 1;
-
-          auto model = CppTools::CppModelManager::instance ();
-          auto snapshot = model->snapshot ();
-          auto cppDocument = snapshot.document (doc->filePath ().toString ());
-          if (!cppDocument) {
-            qCritical () << "parse failed" << cppDocument;
+          QFile file (selected);
+          if (!file.open (QFile::WriteOnly)) {
+            MessageManager::writeFlashing (IncludeUtils::tr ("Failed to write %1").arg (selected));
             return;
           }
+          file.write (text.toUtf8 ());
+        }
 
-          for (const auto &inc: cppDocument->resolvedIncludes ()) {
-            //            qCritical () << inc.resolvedFileName () << inc.line () << inc.unresolvedFileName () << line;
-            if (inc.line () != line) {
-              continue;
-            }
+        void savePatch (const QString &patch, const QDir &base) {
+          saveText (patch, IncludeUtils::tr ("Save includes patch"),
+                    base.filePath (QLatin1String ("includes.patch")),
+                    IncludeUtils::tr ("Patch files (*.patch)"));
+        }
+      }
 
-            const auto includes = snapshot.allIncludesForDocument (inc.resolvedFileName ());
+      class WeightHoverHandle : public TextEditor::BaseHoverHandler {
+        public:
+          explicit WeightHoverHandle (QSharedPointer<IncludeGraph> graph) :
+            graph_ (graph) {
+          }
 
-            auto own = QFileInfo (inc.resolvedFileName ()).size ();
-            auto weight = own;
-            for (const auto &i: includes) {
-              weight += QFileInfo (i).size ();
+        private:
+          void identifyMatch (TextEditor::TextEditorWidget *editorWidget, int pos,
+                              ReportPriority report) override {
+            Utils::ExecuteOnDestruction reportPriority ([this, report]() {
+              report (priority ());
+            });
+
+            auto doc = editorWidget->textDocument ();
+            auto block = doc->document ()->findBlock (pos);
+            if (!block.text ().startsWith ("#include")) {
+              return;
             }
 
-            const QString str = inc.resolvedFileName () + " =  " +
-                                QString::number (own / 1024., 'f', 1) +
-                                +"(" + QString::number (weight / 1024., 'f', 1) + ") Kb";
-            setToolTip (str);
-            break;
-          }
+            const auto line = block.firstLineNumber () + 1;
 
-          //          auto cppDocument = snapshot.preprocessedDocument (doc->filePath ()->contents (),
-          //                                                            documentFile);
+            auto model = CppTools::CppModelManager::instance ();
+            auto snapshot = model->snapshot ();
+            auto cppDocument = snapshot.document (doc->filePath ().toString ());
+            if (!cppDocument) {
+              return;
+            }
 
-          //          const auto line = editorWidget->textAt (pos - 100, pos + 100);
-          //          qCritical () << line;
-          //          setToolTip (line);
+            for (const auto &inc: cppDocument->resolvedIncludes ()) {
+              if (inc.line () != line) {
+                continue;
+              }
+
+              // costs are computed by annotations and graph updates, not here
+              const auto fileName = inc.resolvedFileName ();
+              auto weight = 0u;
+              IncludeGraph::Dependents dependents;
+              if (!graph_->cachedCosts (fileName, weight, dependents)) {
+                setToolTip (fileName + "\n" + IncludeUtils::tr ("Size is not computed yet"));
+                break;
+              }
+              const auto own = graph_->ownWeight (fileName);
+
+              const QString str = fileName + " =  " +
+                                  QString::number (own / 1024., 'f', 1) +
+                                  +"(" + QString::number (weight / 1024., 'f', 1) + ") Kb\n" +
+                                  IncludeUtils::tr ("Included by %1 units, %2 Kb to rebuild on change")
+                                  .arg (dependents.units)
+                                  .arg (dependents.recompiled / 1024., 0, 'f', 1);
+              setToolTip (str);
+              break;
+            }
+          }
 
-          //          const auto current = Core::EditorManager::currentDocument ();
-          //          auto documentFile = current->filePath ().toString ();
-        }
+          QSharedPointer<IncludeGraph> graph_;
       };
 
-      IncludeUtils::IncludeUtils (ExtensionSystem::IPlugin *plugin) {
+      IncludeUtils::IncludeUtils (ExtensionSystem::IPlugin *plugin) :
+        graph_ (new IncludeGraph),
+        lookups_ (new LookupCache),
+        annotations_ (nullptr),
+        options_ (new IncludeOptionsPage (this)),
+        report_ (new IncludeReportPane (this)),
+        index_ (new SymbolIndex (Core::ICore::userResourcePath ().toString ()
+                                 + QLatin1String ("/QtcUtilities/includes.index"))) {
         using namespace Core;
         auto menu = ActionManager::createMenu (MENU_ID);
         menu->menu ()->setTitle (tr ("Includes1"));
@@ -111,181 +205,562 @@ namespace QtcUtilities {
 
         {
           auto action = new QAction (tr ("Include utils1"), this);
-          connect (action, &QAction::triggered, this, &IncludeUtils::organize);
+          connect (action, &QAction::triggered, this, [this] {
+            organize (AllChanges);
+          });
           auto command = ActionManager::registerAction (action, ACTION_ORGANIZE_INCLUDES);
           command->setDefaultKeySequence (QKeySequence (tr ("Alt+I,Alt+I")));
           menu->addAction (command);
         }
 
+        {
+          auto action = new QAction (tr ("Add missing includes"), this);
+          connect (action, &QAction::triggered, this, [this] {
+            organize (AddMissing);
+          });
+          auto command = ActionManager::registerAction (action, ACTION_ADD_INCLUDES);
+          menu->addAction (command);
+        }
+
+        {
+          auto action = new QAction (tr ("Replace includes with forward declarations"), this);
+          connect (action, &QAction::triggered, this, [this] {
+            organize (ForwardDeclare);
+          });
+          auto command = ActionManager::registerAction (action, ACTION_FORWARD_DECLARE);
+          menu->addAction (command);
+        }
+
+        {
+          auto action = new QAction (tr ("Sort includes"), this);
+          connect (action, &QAction::triggered, this, &IncludeUtils::sortIncludes);
+          auto command = ActionManager::registerAction (action, ACTION_SORT_INCLUDES);
+          menu->addAction (command);
+        }
+
+        {
+          auto action = new QAction (tr ("Organize includes in project"), this);
+          connect (action, &QAction::triggered, this, &IncludeUtils::organizeProject);
+          auto command = ActionManager::registerAction (action, ACTION_ORGANIZE_PROJECT_INCLUDES);
+          menu->addAction (command);
+        }
+
+        {
+          auto action = new QAction (tr ("Sort includes in project"), this);
+          connect (action, &QAction::triggered, this, &IncludeUtils::sortProject);
+          auto command = ActionManager::registerAction (action, ACTION_SORT_PROJECT_INCLUDES);
+          menu->addAction (command);
+        }
+
+        {
+          auto action = new QAction (tr ("Find include cycles in project"), this);
+          connect (action, &QAction::triggered, this, &IncludeUtils::findCycles);
+          auto command = ActionManager::registerAction (action, ACTION_FIND_INCLUDE_CYCLES);
+          menu->addAction (command);
+        }
+
+        {
+          auto action = new QAction (tr ("Show rebuild cost of project headers"), this);
+          connect (action, &QAction::triggered, this, &IncludeUtils::showFanOut);
+          auto command = ActionManager::registerAction (action, ACTION_SHOW_FAN_OUT);
+          menu->addAction (command);
+        }
+
+        {
+          auto action = new QAction (tr ("Propose precompiled header for project"), this);
+          connect (action, &QAction::triggered, this, &IncludeUtils::proposePch);
+          auto command = ActionManager::registerAction (action, ACTION_PROPOSE_PCH);
+          menu->addAction (command);
+        }
+
+        {
+          auto action = new QAction (tr ("Propose unity build groups for project"), this);
+          connect (action, &QAction::triggered, this, &IncludeUtils::proposeUnity);
+          auto command = ActionManager::registerAction (action, ACTION_PROPOSE_UNITY);
+          menu->addAction (command);
+        }
+
         auto factories = Core::IEditorFactory::allEditorFactories ();
         for (const auto f: factories) {
           if (auto text = dynamic_cast<TextEditor::TextEditorFactory *>(f)) {
-            text->addHoverHandler (new WeightHoverHandle);
+            text->addHoverHandler (new WeightHoverHandle (graph_));
+          }
+        }
+
+        auto model = CppTools::CppModelManager::instance ();
+        connect (model, &CppTools::CppModelManager::documentUpdated,
+                 this, [this](CPlusPlus::Document::Ptr document) {
+          graph_->update (document);
+          if (document) {
+            lookups_->invalidate (document->fileName ());
+          }
+        });
+        connect (model, &CppTools::CppModelManager::aboutToRemoveFiles,
+                 this, [this](const QStringList &files) {
+          graph_->remove (files);
+          for (const auto &file: files) {
+            lookups_->invalidate (file);
+          }
+        });
+
+        annotations_ = new IncludeAnnotations (graph_, this);
+
+        connect (ProgressManager::instance (), &ProgressManager::allTasksFinished,
+                 this, [this](Utils::Id type) {
+          if (type == CppTools::Constants::TASK_INDEX) {
+            updateIndex ();
+            updateGraph ();
+          }
+        });
+      }
+
+      void IncludeUtils::organize (int changes) {
+        using namespace Core;
+        using namespace CppTools;
+
+        auto current = qobject_cast<TextEditor::TextDocument *>(EditorManager::currentDocument ());
+        if (!current) {
+          return;
+        }
+
+        const auto revision = current->document ()->revision ();
+        auto model = CppModelManager::instance ();
+        auto future = Utils::runAsync (organizeIncludes, model->snapshot (), current->contents (),
+                                       current->filePath ().toString (), graph_, lookups_);
+        ProgressManager::addTask (future, tr ("Organize includes"), TASK_ORGANIZE_INCLUDES);
+
+        auto watcher = new QFutureWatcher<OrganizeResult>(this);
+        QPointer<TextEditor::TextDocument> document (current);
+        connect (watcher, &QFutureWatcherBase::finished,
+                 this, [watcher, document, revision, changes, index = index_] {
+          watcher->deleteLater ();
+          if (watcher->isCanceled () || watcher->future ().resultCount () == 0) {
+            return;
+          }
+          if (!document || document->document ()->revision () != revision) {
+            MessageManager::writeSilently (tr ("Includes were not organized: document changed"));
+            return;
+          }
+
+          const auto result = watcher->result ();
+          IncludeModifier modifier (result.document, document->document ());
+          if (changes & RemoveUnused) {
+            modifier.queueDuplicatesRemoval ();
+            modifier.queueUpdates (*result.tree);
+          }
+          if (changes & AddMissing) {
+            modifier.queueAdditions (result.additions);
+          }
+          if (changes & ForwardDeclare) {
+            for (const auto &declarations: result.forwardDeclarations) {
+              modifier.queueReplacement (declarations.fileName, declarations.declarations);
+            }
+          }
+          modifier.executeQueue ();
+
+          if (!(changes & ForwardDeclare) && !result.forwardDeclarations.isEmpty ()) {
+            QStringList replaceable;
+            for (const auto &declarations: result.forwardDeclarations) {
+              replaceable.append (tr ("%1: %2 Kb less to parse")
+                                  .arg (declarations.fileName)
+                                  .arg (declarations.savedWeight / 1024., 0, 'f', 1));
+            }
+            MessageManager::writeSilently (
+              tr ("Includes replaceable with forward declarations:\n%1")
+              .arg (replaceable.join (QLatin1Char ('\n'))));
+          }
+
+          QStringList suggestions;
+          for (const auto &name: result.unresolved) {
+            const auto headers = index->headers (name);
+            if (!headers.isEmpty ()) {
+              suggestions.append (name + QLatin1String (": ") + headers.join (QLatin1String (", ")));
+            }
+          }
+          if (!suggestions.isEmpty ()) {
+            MessageManager::writeSilently (tr ("Possibly missing includes:\n%1")
+                                           .arg (suggestions.join (QLatin1Char ('\n'))));
+          }
+        });
+        watcher->setFuture (future);
+      }
+
+      void IncludeUtils::organizeProject () {
+        using namespace Core;
+        using namespace CppTools;
+        using namespace ProjectExplorer;
+
+        auto project = ProjectTree::currentProject ();
+        if (!project) {
+          return;
+        }
+
+        const auto files = projectFiles (project, false);
+        if (files.isEmpty ()) {
+          return;
+        }
+
+        auto model = CppModelManager::instance ();
+        auto future = QtConcurrent::mapped (files, BatchOrganizer (model->snapshot (),
+                                                                   model->workingCopy (), graph_,
+                                                                   lookups_));
+        ProgressManager::addTask (future, tr ("Organize includes in project"),
+                                  TASK_ORGANIZE_PROJECT_INCLUDES);
+
+        const auto base = QDir (project->projectDirectory ().toString ());
+        auto watcher = new QFutureWatcher<BatchFileResult>(this);
+        connect (watcher, &QFutureWatcherBase::finished,
+                 this, [watcher, base] {
+          watcher->deleteLater ();
+          if (watcher->isCanceled ()) {
+            return;
           }
+
+          QString patch;
+          auto changedFiles = 0;
+          auto removedIncludes = 0;
+          auto savedWeight = 0ull;
+          for (const auto &result: watcher->future ().results ()) {
+            if (result.removedLines.isEmpty ()) {
+              continue;
+            }
+            patch += unifiedDiff (result, base);
+            ++changedFiles;
+            removedIncludes += result.removedIncludes.size ();
+            savedWeight += result.savedWeight;
+          }
+
+          MessageManager::writeFlashing (
+            tr ("Organize includes: %1 includes can be removed from %2 files, %3 Kb less to parse")
+            .arg (removedIncludes).arg (changedFiles).arg (savedWeight / 1024., 0, 'f', 1));
+          if (!patch.isEmpty ()) {
+            savePatch (patch, base);
+          }
+        });
+        watcher->setFuture (future);
+      }
+
+      void IncludeUtils::sortIncludes () {
+        using namespace Core;
+
+        auto current = qobject_cast<TextEditor::TextDocument *>(EditorManager::currentDocument ());
+        if (!current) {
+          return;
+        }
+
+        auto snapshot = CppTools::CppModelManager::instance ()->snapshot ();
+        auto document = snapshot.document (current->filePath ().toString ());
+        if (!document) {
+          return;
+        }
+
+        IncludeModifier modifier (document, current->document ());
+        modifier.queueSorting (IncludeSorter (options_->sortRules ()));
+        modifier.executeQueue ();
+      }
+
+      void IncludeUtils::sortProject () {
+        using namespace Core;
+        using namespace CppTools;
+        using namespace ProjectExplorer;
+
+        auto project = ProjectTree::currentProject ();
+        if (!project) {
+          return;
+        }
+
+        const auto files = projectFiles (project, true);
+        if (files.isEmpty ()) {
+          return;
         }
+
+        auto model = CppModelManager::instance ();
+        auto future = QtConcurrent::mapped (files, BatchSorter (model->snapshot (),
+                                                                model->workingCopy (),
+                                                                IncludeSorter (options_->sortRules ())));
+        ProgressManager::addTask (future, tr ("Sort includes in project"),
+                                  TASK_SORT_PROJECT_INCLUDES);
+
+        const auto base = QDir (project->projectDirectory ().toString ());
+        auto watcher = new QFutureWatcher<BatchFileResult>(this);
+        connect (watcher, &QFutureWatcherBase::finished,
+                 this, [watcher, base] {
+          watcher->deleteLater ();
+          if (watcher->isCanceled ()) {
+            return;
+          }
+
+          QString patch;
+          auto changedFiles = 0;
+          for (const auto &result: watcher->future ().results ()) {
+            const auto diff = unifiedDiff (result, base);
+            if (!diff.isEmpty ()) {
+              patch += diff;
+              ++changedFiles;
+            }
+          }
+
+          MessageManager::writeFlashing (tr ("Sort includes: %1 files can be changed")
+                                         .arg (changedFiles));
+          if (!patch.isEmpty ()) {
+            savePatch (patch, base);
+          }
+        });
+        watcher->setFuture (future);
       }
 
-      void IncludeUtils::organize () {
+      void IncludeUtils::findCycles () {
         using namespace Core;
         using namespace CppTools;
-        using namespace CPlusPlus;
+        using namespace ProjectExplorer;
+
+        auto project = ProjectTree::currentProject ();
+        if (!project) {
+          return;
+        }
 
-        const auto current = EditorManager::currentDocument ();
+        const auto files = projectFiles (project, true);
+        if (files.isEmpty ()) {
+          return;
+        }
 
         auto model = CppModelManager::instance ();
-        auto snapshot = model->snapshot ();
-        auto documentFile = current->filePath ().toString ();
-        auto cppDocument = snapshot.preprocessedDocument (current->contents (),
-                                                          documentFile);
-        if (!cppDocument || !cppDocument->parse ()) {
-          qCritical () << "parse failed";
+        auto future = Utils::runAsync (includeCycles, model->snapshot (), files, graph_);
+        ProgressManager::addTask (future, tr ("Find include cycles"), TASK_FIND_INCLUDE_CYCLES);
+
+        auto watcher = new QFutureWatcher<QVector<IncludeCycle> >(this);
+        connect (watcher, &QFutureWatcherBase::finished,
+                 this, [this, watcher] {
+          watcher->deleteLater ();
+          if (watcher->isCanceled () || watcher->future ().resultCount () == 0) {
+            return;
+          }
+
+          const auto cycles = watcher->result ();
+          const auto kb = [](quint64 bytes) {
+                            return QString::number (bytes / 1024., 'f', 1);
+                          };
+          QList<QList<QStandardItem *> > rows;
+          for (const auto &cycle: cycles) {
+            auto files = IncludeReportPane::textItem (tr ("%n files", nullptr, cycle.files.size ()));
+            for (const auto &file: cycle.files) {
+              files->appendRow (IncludeReportPane::fileItem (file));
+            }
+            const auto edge = tr ("%1 -> %2 (%3 Kb)%4")
+                              .arg (QFileInfo (cycle.from).fileName (),
+                                    QFileInfo (cycle.to).fileName (), kb (cycle.edgeWeight),
+                                    cycle.isBroken ? QString () : tr (", not enough alone"));
+            rows.append ({files, IncludeReportPane::numberItem (cycle.weight, kb (cycle.weight)),
+                          IncludeReportPane::textItem (edge)});
+          }
+          report_->setReport ({tr ("Cycle"), tr ("Weight, Kb"), tr ("Cheapest include to remove")},
+                              rows);
+          MessageManager::writeSilently (tr ("Include cycles found: %1").arg (cycles.size ()));
+        });
+        watcher->setFuture (future);
+      }
+
+      void IncludeUtils::showFanOut () {
+        using namespace Core;
+        using namespace CppTools;
+        using namespace ProjectExplorer;
+
+        auto project = ProjectTree::currentProject ();
+        if (!project) {
           return;
         }
-        cppDocument->check ();
 
+        const auto files = projectFiles (project, true);
+        if (files.isEmpty ()) {
+          return;
+        }
+
+        auto model = CppModelManager::instance ();
+        auto future = Utils::runAsync (includeFanOut, model->snapshot (), files, graph_);
+        ProgressManager::addTask (future, tr ("Find rebuild cost of headers"), TASK_FIND_FAN_OUT);
+
+        auto watcher = new QFutureWatcher<QVector<IncludeFanOut> >(this);
+        connect (watcher, &QFutureWatcherBase::finished,
+                 this, [this, watcher] {
+          watcher->deleteLater ();
+          if (watcher->isCanceled () || watcher->future ().resultCount () == 0) {
+            return;
+          }
 
-        auto control = cppDocument->control ();
-        if (control->symbolCount () == 0) {
-          qCritical () << "no symbols";
+          const auto kb = [](quint64 bytes) {
+                            return QString::number (bytes / 1024., 'f', 1);
+                          };
+          QList<QList<QStandardItem *> > rows;
+          for (const auto &header: watcher->result ()) {
+            rows.append ({
+              IncludeReportPane::fileItem (header.fileName),
+              IncludeReportPane::numberItem (header.units, QString::number (header.units)),
+              IncludeReportPane::numberItem (header.recompiled, kb (header.recompiled)),
+              IncludeReportPane::numberItem (header.ownWeight, kb (header.ownWeight))
+            });
+          }
+          report_->setReport ({tr ("Header"), tr ("Units"), tr ("Rebuilt, Kb"), tr ("Own, Kb")},
+                              rows);
+        });
+        watcher->setFuture (future);
+      }
+
+      void IncludeUtils::proposePch () {
+        using namespace Core;
+        using namespace CppTools;
+        using namespace ProjectExplorer;
+
+        auto project = ProjectTree::currentProject ();
+        if (!project) {
           return;
         }
-        qCritical () << "symbols count" << control->symbolCount ();
-        if (!control->firstSymbol ()) {
-          qCritical () << "no first symbol";
+
+        const auto files = projectFiles (project, true);
+        if (files.isEmpty ()) {
           return;
         }
 
-        //        Symbol **end = control->lastSymbol ();
-        //        uint index = 0;
-        //        for (Symbol **it = control->firstSymbol (); it != end; ++it) {
-        //          ++index;
-        //          qCritical () << "symbol" << index
-        //                    << (*it)->fileName ()
-        //                    << (*it)->line ()
-        //                    << (*it)->column ()
-        //                    << (*it)->visibility ()
-        //                    << (*it)->type ().isUnavailable ()
-        //                    << (*it)->type ()->isUndefinedType ()
-        //          ;
-        //          //          if ((*it)->unqualifiedName () && (*it)->unqualifiedName ()->identifier ()) {
-        //          //            qCritical () << "unqualifiedName"
-        //          //                      << (*it)->unqualifiedName ()->identifier ()->chars ();
-        //          //          }
-        //          if ((*it)->name () && (*it)->name ()->identifier ()) {
-        //            qCritical () << "name" << (*it)->name ()->identifier ()->chars ();
-        //          }
-        //          if ((*it)->identifier ()) {
-        //            qCritical () << "id" << (*it)->identifier ()->chars ();
-        //          }
-        //          //          if (const Function *function = (*it)->asFunction ()) {
-        //          //          }
-        //        }
-
-        qCritical () << "macros" << cppDocument->definedMacros ().size ();
-        for (const auto &macro: cppDocument->definedMacros ()) {
-          qCritical () << macro.nameToQString ();
+        auto model = CppModelManager::instance ();
+        auto future = Utils::runAsync (precompiledHeader, model->snapshot (), files, graph_);
+        ProgressManager::addTask (future, tr ("Propose precompiled header"), TASK_PROPOSE_PCH);
+
+        const auto base = QDir (project->projectDirectory ().toString ());
+        auto watcher = new QFutureWatcher<PchProposal>(this);
+        connect (watcher, &QFutureWatcherBase::finished,
+                 this, [this, watcher, base] {
+          watcher->deleteLater ();
+          if (watcher->isCanceled () || watcher->future ().resultCount () == 0) {
+            return;
+          }
+
+          const auto proposal = watcher->result ();
+          const auto kb = [](quint64 bytes) {
+                            return QString::number (bytes / 1024., 'f', 1);
+                          };
+          QList<QList<QStandardItem *> > rows;
+          QStringList chosen;
+          for (const auto &candidate: proposal.candidates) {
+            rows.append ({
+              IncludeReportPane::fileItem (candidate.fileName),
+              IncludeReportPane::numberItem (candidate.units, QString::number (candidate.units)),
+              IncludeReportPane::numberItem (candidate.weight, kb (candidate.weight)),
+              IncludeReportPane::numberItem (candidate.stability,
+                                             QString::number (candidate.stability, 'f', 2)),
+              IncludeReportPane::textItem (candidate.isChosen ? tr ("yes") : QString ())
+            });
+            if (candidate.isChosen) {
+              chosen.append (candidate.fileName);
+            }
+          }
+          report_->setReport ({tr ("Header"), tr ("Units"), tr ("Weight, Kb"), tr ("Stability"),
+                               tr ("Proposed")}, rows);
+
+          const auto share = proposal.parsed > 0 ? 100. * proposal.saved / proposal.parsed : 0.;
+          MessageManager::writeFlashing (
+            tr ("Precompiled header: %1 headers, %2 Kb. Units parse %3 Kb less of %4 Kb (%5%)")
+            .arg (chosen.size ()).arg (kb (proposal.size)).arg (kb (proposal.saved))
+            .arg (kb (proposal.parsed)).arg (share, 0, 'f', 1));
+          if (chosen.isEmpty ()) {
+            return;
+          }
+
+          saveText (chosen.join (QLatin1Char ('\n')) + QLatin1Char ('\n'),
+                    tr ("Save precompiled header list"),
+                    base.filePath (QLatin1String ("pch-headers.txt")), tr ("Text files (*.txt)"));
+        });
+        watcher->setFuture (future);
+      }
+
+      void IncludeUtils::proposeUnity () {
+        using namespace Core;
+        using namespace CppTools;
+        using namespace ProjectExplorer;
+
+        auto project = ProjectTree::currentProject ();
+        if (!project) {
+          return;
         }
 
-        if (cppDocument->fileName ().isEmpty ()) {
+        const auto files = projectFiles (project, false);
+        if (files.isEmpty ()) {
           return;
         }
 
-        qCritical () << "macro uses" << cppDocument->macroUses ().size ();
-        for (const auto &macro: cppDocument->macroUses ()) {
-          qCritical () << macro.macro ().nameToQString ();
+        auto model = CppModelManager::instance ();
+        auto future = Utils::runAsync (unityGroups, model->snapshot (), files, graph_);
+        ProgressManager::addTask (future, tr ("Propose unity build groups"), TASK_PROPOSE_UNITY);
+
+        auto watcher = new QFutureWatcher<QVector<UnityGroup> >(this);
+        connect (watcher, &QFutureWatcherBase::finished,
+                 this, [this, watcher] {
+          watcher->deleteLater ();
+          if (watcher->isCanceled () || watcher->future ().resultCount () == 0) {
+            return;
+          }
+
+          const auto groups = watcher->result ();
+          const auto kb = [](quint64 bytes) {
+                            return QString::number (bytes / 1024., 'f', 1);
+                          };
+          QList<QList<QStandardItem *> > rows;
+          auto saved = quint64 (0);
+          for (const auto &group: groups) {
+            auto files = IncludeReportPane::textItem (tr ("%n files", nullptr, group.files.size ()));
+            for (const auto &file: group.files) {
+              files->appendRow (IncludeReportPane::fileItem (file));
+            }
+            rows.append ({files, IncludeReportPane::numberItem (group.parsed, kb (group.parsed)),
+                          IncludeReportPane::numberItem (group.merged, kb (group.merged)),
+                          IncludeReportPane::numberItem (group.parsed - group.merged,
+                                                         kb (group.parsed - group.merged))});
+            saved += group.parsed - group.merged;
+          }
+          report_->setReport ({tr ("Group"), tr ("Separately, Kb"), tr ("Unity, Kb"),
+                               tr ("Saved, Kb")}, rows);
+          MessageManager::writeSilently (tr ("Unity build groups: %1, %2 Kb less to parse")
+                                         .arg (groups.size ()).arg (kb (saved)));
+        });
+        watcher->setFuture (future);
+      }
+
+      void IncludeUtils::updateGraph () {
+        if (expanding_.isRunning ()) {
+          return;
         }
 
-        if (cppDocument->fileName ().isEmpty ()) {
+        // reverse edges of the whole snapshot, for rebuild costs
+        auto snapshot = CppTools::CppModelManager::instance ()->snapshot ();
+        expanding_ = Utils::runAsync ([graph = graph_, snapshot] {
+          QStringList files;
+          for (auto it = snapshot.begin (), end = snapshot.end (); it != end; ++it) {
+            files.append (it.key ().toString ());
+          }
+          graph->expand (files, snapshot);
+        });
+        Core::ProgressManager::addTask (expanding_, tr ("Index includes"), TASK_EXPAND_GRAPH);
+      }
+
+      void IncludeUtils::updateIndex () {
+        if (indexing_.isRunning ()) {
           return;
         }
 
-        //        qCritical () << "all macros" << model->definedMacros ().size ();
-        //        for (const auto &macro: model->definedMacros ()) {
-        //          qCritical () << macro.key << macro.value;
-        //        }
-
-        //        if (cppDocument->fileName ().isEmpty ()) {
-        //          return;
-        //        }
-
-        IncludeExtractor extractor (cppDocument, snapshot);
-        qCritical () << "current" << cppDocument->fileName ();
-        IncludeTree tree (cppDocument->fileName ());
-        tree.build (snapshot);
-        qCritical () << "was" << tree.includes ();
-
-
-
-        //        for (const auto &inc: cppDocument->resolvedIncludes ()) {
-        //          const auto node = tree.node (inc.resolvedFileName ());
-        //          //          using Diag = Document::DiagnosticMessage;
-        //          //          qCritical () << "diag" << node.fileName () << node.weight ()
-        //          //                    << inc.resolvedFileName ();
-        //          const auto weight = tree.totalWeight (snapshot.allIncludesForDocument (cppDocument->fileName ()));
-        //          const QString str =
-        //            "Weight " + QString::number (weight / 1024., 'f', 1) + " Kb";
-        //          qCritical () << str << node.fileName ();
-        //          //                  auto mark = new TextEditor::TextMark (
-        //          //                    Utils::FileName::fromString (cppDocument->fileName ()),
-        //          //                    inc.line (), "INC.INCLUDES.WEIGHT");
-        //          //                  mark->setLineAnnotation (str);
-        //          //                  mark->setDefaultToolTip (str);
-        //          //                  mark->setToolTip (str);
-        //          //          cppDocument->addDiagnosticMessage ({Diag::Warning, cppDocument->fileName (),
-        //          //                                              inc.line (), 0, QString::number (node.weight ())});
-        //        }
-        //        return;
-
-        tree.distribute (extractor.symbols ());
-        qCritical () << "distributed symbols" << tree.root ().allSymbols ().size ()
-                     << "from" << extractor.symbols ().size ();
-
-        tree.distribute (cppDocument->macroUses ());
-        qCritical () << "distributed macros" << tree.root ().allMacros ()
-                     << "from" << cppDocument->macroUses ().size ();
-
-        tree.removeEmptyPaths ();
-        qCritical () << "removed empty" << tree.includes ();
-
-        tree.removeNestedPaths ();
-        qCritical () << "removed nested" << tree.includes ();
-
-        IncludeModifier modifier (cppDocument);
-        modifier.queueDuplicatesRemoval ();
-        modifier.queueUpdates (tree);
-        modifier.executeQueue ();
+        auto snapshot = CppTools::CppModelManager::instance ()->snapshot ();
+        indexing_ = Utils::runAsync (SymbolIndex::build, snapshot, index_->data ());
+        Core::ProgressManager::addTask (indexing_, tr ("Index include symbols"), TASK_INDEX_SYMBOLS);
 
-        return;
-
-        //        auto symbol = *control->firstSymbol ();
-        //        uint index = 0;
-        //        while (symbol) {
-        //          ++index;
-        //          qCritical () << "symbol" << index
-        //                    << symbol->fileName ()
-        //                    << symbol->line ()
-        //                    << symbol->column ()
-        //                    << symbol->visibility ();
-        //          if (symbol->name () && symbol->name ()->identifier ()) {
-        //            qCritical () << "name" << symbol->name ()->identifier ()->chars ();
-        //          }
-        //          if (symbol->identifier ()) {
-        //            qCritical () << "id" << symbol->identifier ()->chars ();
-        //          }
-        //          symbol = symbol->next ();
-        //        }
-
-        //        auto first = *control->firstSymbol ();
-        //        for (auto i = 0u, end = control->symbolCount (); i < end; ++i) {
-        //          auto s = first + i;
-        //          qCritical () << "symbol" << i;
-        //          if (s->name () && s->name ()->identifier ()) {
-        //            qCritical () << "name" << s->name ()->identifier ()->chars ();
-        //          }
-        //          if (symbol->identifier ()) {
-        //            qCritical () << "id" << s->identifier ()->chars ();
-        //          }
-        //        }
+        auto watcher = new QFutureWatcher<QByteArray>(this);
+        connect (watcher, &QFutureWatcherBase::finished,
+                 this, [this, watcher] {
+          watcher->deleteLater ();
+          if (watcher->isCanceled () || watcher->future ().resultCount () == 0) {
+            return;
+          }
+          if (!index_->replace (watcher->result ())) {
+            Core::MessageManager::writeSilently (tr ("Failed to save include symbols index"));
+          }
+        });
+        watcher->setFuture (indexing_);
       }
     } // namespace IncludeUtils
   } // namespace Internal
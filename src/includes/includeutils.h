@@ -1,6 +1,12 @@
 #pragma once
 
+#include "includegraph.h"
+#include "lookupcache.h"
+#include "symbolindex.h"
+
+#include <QFuture>
 #include <QObject>
+#include <QSharedPointer>
 
 namespace ExtensionSystem {
   class IPlugin;
@@ -10,12 +16,39 @@ namespace QtcUtilities {
   namespace Internal {
     namespace IncludeUtils {
 
+      class IncludeAnnotations;
+      class IncludeOptionsPage;
+      class IncludeReportPane;
+
       class IncludeUtils : public QObject {
         public:
           explicit IncludeUtils (ExtensionSystem::IPlugin *plugin);
 
         private:
-          void organize ();
+          enum Change {
+            RemoveUnused = 0x1, AddMissing = 0x2, AllChanges = RemoveUnused | AddMissing,
+            ForwardDeclare = 0x4
+          };
+
+          void organize (int changes);
+          void organizeProject ();
+          void sortIncludes ();
+          void sortProject ();
+          void findCycles ();
+          void showFanOut ();
+          void proposePch ();
+          void proposeUnity ();
+          void updateIndex ();
+          void updateGraph ();
+
+          QSharedPointer<IncludeGraph> graph_;
+          QSharedPointer<LookupCache> lookups_;
+          IncludeAnnotations *annotations_;
+          IncludeOptionsPage *options_;
+          IncludeReportPane *report_;
+          QSharedPointer<SymbolIndex> index_;
+          QFuture<QByteArray> indexing_;
+          QFuture<void> expanding_;
       };
 
     }     // namespace IncludeUtils
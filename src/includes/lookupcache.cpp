@@ -0,0 +1,90 @@
+#include "lookupcache.h"
+
+#include <cplusplus/Symbol.h>
+
+#include <algorithm>
+
+using namespace CPlusPlus;
+
+namespace {
+  const auto maxBindings = 32;
+}
+
+bool LookupCache::find (const QString &document, const QString &name, Scope *scope,
+                        Entry &entry) const {
+  QMutexLocker locker (&mutex_);
+  const auto it = entries_.constFind ({document, {name, scope}});
+  if (it == entries_.cend ()) {
+    return false;
+  }
+  entry = it.value ();
+  return true;
+}
+
+void LookupCache::insert (const QString &document, const QString &name, Scope *scope,
+                          const Entry &entry) {
+  QSet<QString> files {document, QString::fromUtf8 (scope->fileName ())};
+  for (const auto &match: entry.matches) {
+    if (match.declaration ()) {
+      files.insert (QString::fromUtf8 (match.declaration ()->fileName ()));
+    }
+  }
+
+  const Key key {document, {name, scope}};
+  const auto bindings = entry.bindings.data ();
+  QMutexLocker locker (&mutex_);
+  auto it = std::find_if (keysPerBindings_.begin (), keysPerBindings_.end (),
+                          [bindings](const QPair<CreateBindings *, Keys> &i) {
+    return i.first == bindings;
+  });
+  if (it == keysPerBindings_.end ()) {
+    if (keysPerBindings_.size () >= maxBindings) {
+      evictOldest ();
+    }
+    keysPerBindings_.append ({bindings, {}});
+    it = keysPerBindings_.end () - 1;
+  }
+  it->second.append (key);
+
+  entries_.insert (key, entry);
+  for (const auto &file: files) {
+    keysPerFile_[file].append (key);
+  }
+}
+
+void LookupCache::evictOldest () {
+  const auto oldest = keysPerBindings_.takeFirst ();
+  for (const auto &key: oldest.second) {
+    const auto it = entries_.find (key);
+    // may be replaced by an entry of newer bindings
+    if (it != entries_.end () && it->bindings.data () == oldest.first) {
+      entries_.erase (it);
+    }
+  }
+  for (auto it = keysPerFile_.begin (); it != keysPerFile_.end ();) {
+    auto &keys = it.value ();
+    keys.erase (std::remove_if (keys.begin (), keys.end (), [this](const Key &key) {
+      return !entries_.contains (key);
+    }), keys.end ());
+    if (keys.isEmpty ()) {
+      it = keysPerFile_.erase (it);
+    }
+    else {
+      ++it;
+    }
+  }
+}
+
+void LookupCache::invalidate (const QString &fileName) {
+  QMutexLocker locker (&mutex_);
+  for (const auto &key: keysPerFile_.take (fileName)) {
+    entries_.remove (key);
+  }
+}
+
+void LookupCache::clear () {
+  QMutexLocker locker (&mutex_);
+  entries_.clear ();
+  keysPerFile_.clear ();
+  keysPerBindings_.clear ();
+}
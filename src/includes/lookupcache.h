@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cplusplus/LookupContext.h>
+
+#include <QHash>
+#include <QMutex>
+
+// Lookup results of names in scopes of included documents, reused by later
+// extractions of the same document: its parallel parts and repeated runs.
+// Results depend on the document's include closure, so they are not shared
+// between documents, even those including the same files.
+// Expressions with nested lookups, e.g. template arguments, are not cached:
+// those resolve in scopes of the extracted document, which do not outlive it.
+// Entries keep the bindings they were resolved with alive, and so the whole
+// snapshot of that extraction with its documents and symbols. Memory is
+// bounded by the number of kept bindings. All methods are thread safe.
+class LookupCache {
+  public:
+    struct Entry {
+      QList<CPlusPlus::LookupItem> matches;
+      QSharedPointer<CPlusPlus::CreateBindings> bindings;
+    };
+
+    bool find (const QString &document, const QString &name, CPlusPlus::Scope *scope,
+               Entry &entry) const;
+    void insert (const QString &document, const QString &name, CPlusPlus::Scope *scope,
+                 const Entry &entry);
+    void invalidate (const QString &fileName);
+    void clear ();
+
+  private:
+    using Key = QPair<QString, QPair<QString, CPlusPlus::Scope *> >;
+    using Keys = QVector<Key>;
+
+    void evictOldest ();
+
+    mutable QMutex mutex_;
+    QHash<Key, Entry> entries_;
+    QHash<QString, Keys> keysPerFile_; // entries depending on file
+    QVector<QPair<CPlusPlus::CreateBindings *, Keys> > keysPerBindings_; // oldest first
+};
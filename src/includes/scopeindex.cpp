@@ -0,0 +1,83 @@
+#include "scopeindex.h"
+
+#include <cplusplus/Symbols.h>
+
+#include <limits>
+
+using namespace CPlusPlus;
+
+namespace {
+  // scopes that Document::scopeAt can return
+  bool isLookupScope (Symbol *symbol) {
+    return symbol->asNamespace () || symbol->asClass () || symbol->asFunction ()
+           || symbol->asBlock () || symbol->asObjCClass () || symbol->asObjCProtocol ()
+           || symbol->asObjCMethod ();
+  }
+}
+
+ScopeIndex::ScopeIndex (const Document::Ptr &document) :
+  translationUnit_ (document ? document->translationUnit () : nullptr) {
+  if (!translationUnit_ || !document->globalNamespace ()) {
+    return;
+  }
+  add (document->globalNamespace (), std::numeric_limits<int>::min (),
+       std::numeric_limits<int>::max ());
+}
+
+Scope *ScopeIndex::scopeAt (int line) const {
+  const auto it = std::upper_bound (segments_.cbegin (), segments_.cend (), line,
+                                    [](int line, const Segment &segment) {
+    return line < segment.firstLine;
+  });
+  return it != segments_.cbegin () ? (it - 1)->scope : nullptr;
+}
+
+QVector<ScopeIndex::Range> ScopeIndex::nested (Scope *scope) const {
+  QVector<Range> result;
+  for (auto i = 0, end = scope->memberCount (); i < end; ++i) {
+    const auto member = scope->memberAt (i);
+    const auto memberScope = member ? member->asScope () : nullptr;
+    if (!memberScope) {
+      continue;
+    }
+    if (!isLookupScope (member)) {
+      // e.g. template, whose declaration is the scope
+      result += nested (memberScope);
+      continue;
+    }
+
+    auto startLine = 0;
+    auto endLine = 0;
+    translationUnit_->getPosition (memberScope->startOffset (), &startLine);
+    translationUnit_->getPosition (memberScope->endOffset (), &endLine);
+    if (startLine < endLine) {
+      result.append ({startLine + 1, endLine, memberScope});
+    }
+  }
+  std::stable_sort (result.begin (), result.end (), [](const Range &l, const Range &r) {
+    return l.firstLine < r.firstLine;
+  });
+  return result;
+}
+
+void ScopeIndex::add (Scope *scope, int firstLine, int lastLine) {
+  auto line = firstLine;
+  for (const auto &range: nested (scope)) {
+    const auto first = std::max (range.firstLine, line);
+    const auto last = std::min (range.lastLine, lastLine);
+    if (first > last) {
+      continue;
+    }
+    if (line < first) {
+      segments_.append ({line, scope});
+    }
+    add (range.scope, first, last);
+    if (last == std::numeric_limits<int>::max ()) {
+      return;
+    }
+    line = last + 1;
+  }
+  if (line <= lastLine) {
+    segments_.append ({line, scope});
+  }
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cplusplus/CppDocument.h>
+
+// Document scopes by line, same as Document::scopeAt (line) but resolved
+// by binary search: a scope owns lines (start line, end line] except
+// those owned by its nested scopes.
+class ScopeIndex {
+  public:
+    explicit ScopeIndex (const CPlusPlus::Document::Ptr &document);
+
+    CPlusPlus::Scope *scopeAt (int line) const;
+
+  private:
+    struct Segment {
+      int firstLine;
+      CPlusPlus::Scope *scope;
+    };
+    struct Range {
+      int firstLine;
+      int lastLine;
+      CPlusPlus::Scope *scope;
+    };
+
+    QVector<Range> nested (CPlusPlus::Scope *scope) const;
+    void add (CPlusPlus::Scope *scope, int firstLine, int lastLine);
+
+    CPlusPlus::TranslationUnit *translationUnit_;
+    QVector<Segment> segments_;
+};
@@ -0,0 +1,187 @@
+#include "setcover.h"
+
+#include <QElapsedTimer>
+
+#include <algorithm>
+#include <limits>
+#include <queue>
+
+struct SetCover::Search {
+  QElapsedTimer timer;
+  int budgetMs;
+  QVector<int> current;
+  QVector<int> best;
+  quint64 bestCost;
+};
+
+SetCover::SetCover (int universeSize) :
+  universeSize_ (universeSize),
+  setsPerElement_ (universeSize) {
+
+}
+
+int SetCover::addSet (const QVector<int> &elements, quint64 cost) {
+  const auto index = sets_.size ();
+  Bitset set (universeSize_);
+  for (const auto element: elements) {
+    if (!set.test (element)) {
+      set.set (element);
+      setsPerElement_[element].append (index);
+    }
+  }
+  sets_.append (set);
+  costs_.append (cost);
+  return index;
+}
+
+QVector<int> SetCover::solve (int timeBudgetMs, int exactLimit) {
+  const auto coverable = this->coverable ();
+  const auto chosen = mandatory (coverable);
+  auto uncovered = coverable;
+  for (const auto i: chosen) {
+    uncovered.subtract (sets_[i]);
+  }
+
+  auto result = greedy (chosen, uncovered);
+  removeRedundant (result, coverable);
+
+  auto candidates = 0;
+  for (auto i = 0, end = sets_.size (); i < end; ++i) {
+    if (!chosen.contains (i) && sets_[i].intersects (uncovered)) {
+      ++candidates;
+    }
+  }
+  if (uncovered.isEmpty () || candidates > exactLimit) {
+    return result;
+  }
+
+  Search search;
+  search.timer.start ();
+  search.budgetMs = timeBudgetMs;
+  search.current = chosen;
+  search.best = result;
+  search.bestCost = cost (result);
+  branch (search, uncovered, cost (chosen));
+  return search.best;
+}
+
+Bitset SetCover::coverable () const {
+  Bitset result (universeSize_);
+  for (const auto &set: sets_) {
+    result.unite (set);
+  }
+  return result;
+}
+
+QVector<int> SetCover::mandatory (const Bitset &coverable) const {
+  QVector<int> result;
+  coverable.forEach ([this, &result](int element) {
+    const auto &sets = setsPerElement_[element];
+    if (sets.size () == 1 && !result.contains (sets.first ())) {
+      result.append (sets.first ());
+    }
+  });
+  return result;
+}
+
+QVector<int> SetCover::greedy (QVector<int> chosen, Bitset uncovered) const {
+  // cost per newly covered element only grows, so stale queue keys are lower bounds
+  using Candidate = std::pair<double, int>;
+  std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate> > queue;
+  const auto ratio = [this, &uncovered](int set) {
+                       const auto gain = sets_[set].intersectionCount (uncovered);
+                       return gain > 0 ? double (costs_[set]) / gain : -1.;
+                     };
+
+  for (auto i = 0, end = sets_.size (); i < end; ++i) {
+    const auto value = ratio (i);
+    if (value >= 0.) {
+      queue.push ({value, i});
+    }
+  }
+
+  while (!uncovered.isEmpty () && !queue.empty ()) {
+    const auto top = queue.top ();
+    queue.pop ();
+    const auto value = ratio (top.second);
+    if (value < 0.) {
+      continue;
+    }
+    if (!queue.empty () && value > queue.top ().first) {
+      queue.push ({value, top.second});
+      continue;
+    }
+    chosen.append (top.second);
+    uncovered.subtract (sets_[top.second]);
+  }
+  return chosen;
+}
+
+void SetCover::removeRedundant (QVector<int> &chosen, const Bitset &coverable) const {
+  QVector<int> coverCount (universeSize_);
+  for (const auto set: chosen) {
+    sets_[set].forEach ([&coverCount](int element) {
+      ++coverCount[element];
+    });
+  }
+
+  auto byCost = chosen;
+  std::sort (byCost.begin (), byCost.end (), [this](int l, int r) {
+    return costs_[l] > costs_[r];
+  });
+  for (const auto set: byCost) {
+    auto isRedundant = true;
+    sets_[set].forEach ([&coverCount, &coverable, &isRedundant](int element) {
+      isRedundant = isRedundant && (coverCount[element] > 1 || !coverable.test (element));
+    });
+    if (!isRedundant) {
+      continue;
+    }
+    sets_[set].forEach ([&coverCount](int element) {
+      --coverCount[element];
+    });
+    chosen.removeOne (set);
+  }
+}
+
+quint64 SetCover::cost (const QVector<int> &chosen) const {
+  auto result = quint64 (0);
+  for (const auto set: chosen) {
+    result += costs_[set];
+  }
+  return result;
+}
+
+void SetCover::branch (Search &search, Bitset uncovered, quint64 cost) const {
+  if (cost >= search.bestCost || search.timer.hasExpired (search.budgetMs)) {
+    return;
+  }
+  if (uncovered.isEmpty ()) {
+    search.best = search.current;
+    search.bestCost = cost;
+    return;
+  }
+
+  // branch on the element with the fewest options
+  auto element = -1;
+  auto fewest = std::numeric_limits<int>::max ();
+  uncovered.forEach ([this, &element, &fewest](int e) {
+    const auto count = setsPerElement_[e].size ();
+    if (count < fewest) {
+      fewest = count;
+      element = e;
+    }
+  });
+
+  auto options = setsPerElement_[element];
+  std::sort (options.begin (), options.end (), [this](int l, int r) {
+    return costs_[l] < costs_[r];
+  });
+  for (const auto set: options) {
+    search.current.append (set);
+    auto next = uncovered;
+    next.subtract (sets_[set]);
+    branch (search, next, cost + costs_[set]);
+    search.current.removeLast ();
+  }
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "bitset.h"
+
+// Weighted set cover: picks sets of minimal total cost covering every
+// element that is covered by any set.
+// Mandatory sets are taken first, the rest is solved by lazy greedy and,
+// for small instances, improved by branch and bound within a time budget.
+class SetCover {
+  public:
+    explicit SetCover (int universeSize);
+
+    int addSet (const QVector<int> &elements, quint64 cost);
+    QVector<int> solve (int timeBudgetMs, int exactLimit = 24);
+
+  private:
+    struct Search;
+
+    Bitset coverable () const;
+    QVector<int> mandatory (const Bitset &coverable) const;
+    QVector<int> greedy (QVector<int> chosen, Bitset uncovered) const;
+    void removeRedundant (QVector<int> &chosen, const Bitset &coverable) const;
+    quint64 cost (const QVector<int> &chosen) const;
+    void branch (Search &search, Bitset uncovered, quint64 cost) const;
+
+    int universeSize_;
+    QVector<Bitset> sets_;
+    QVector<quint64> costs_;
+    QVector<QVector<int> > setsPerElement_;
+};
@@ -0,0 +1,303 @@
+#include "symbolindex.h"
+
+#include <cpptools/projectfile.h>
+
+#include <cplusplus/CppDocument.h>
+#include <cplusplus/Overview.h>
+#include <cplusplus/Symbols.h>
+
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+
+#include <map>
+
+using namespace CPlusPlus;
+
+namespace {
+  const quint32 indexMagic = 0x58444951; // QIDX
+  const quint32 indexVersion = 1;
+
+  QByteArray withoutTemplateArguments (const QString &name) {
+    QByteArray result;
+    result.reserve (name.size ());
+    auto depth = 0;
+    for (const auto c: name) {
+      if (c == QLatin1Char ('<')) {
+        ++depth;
+      }
+      else if (c == QLatin1Char ('>')) {
+        --depth;
+      }
+      else if (depth == 0 && !c.isSpace ()) {
+        result += c.toLatin1 ();
+      }
+    }
+    return result;
+  }
+
+  qint64 modificationTime (const QString &fileName) {
+    return QFileInfo (fileName).lastModified ().toMSecsSinceEpoch ();
+  }
+
+  class Collector {
+    public:
+      explicit Collector (std::multimap<QByteArray, QString> &names, const QString &fileName) :
+        names_ (names),
+        fileName_ (fileName) {
+      }
+
+      void collect (Scope *scope, const QByteArray &prefix) {
+        for (auto i = 0, end = scope->memberCount (); i < end; ++i) {
+          const auto member = scope->memberAt (i);
+          if (!member || member->isForwardClassDeclaration () || member->isGenerated ()) {
+            continue;
+          }
+          if (const auto templ = member->asTemplate ()) {
+            if (const auto declaration = templ->declaration ()) {
+              add (declaration, prefix);
+            }
+            continue;
+          }
+          add (member, prefix);
+        }
+      }
+
+    private:
+      void add (Symbol *symbol, const QByteArray &prefix) {
+        if (!symbol->name ()) {
+          if (const auto ns = symbol->asNamespace ()) {
+            collect (ns, prefix);
+          }
+          return;
+        }
+        if (!symbol->asNamespace () && !symbol->asClass () && !symbol->asEnum ()
+            && !symbol->asDeclaration () && !symbol->asFunction ()) {
+          return;
+        }
+
+        const auto name = withoutTemplateArguments (overview_.prettyName (symbol->name ()));
+        const auto qualified = prefix + name;
+        if (const auto ns = symbol->asNamespace ()) {
+          collect (ns, qualified + "::");
+          return;
+        }
+
+        names_.emplace (qualified, fileName_);
+        if (qualified != name) {
+          names_.emplace (name, fileName_);
+        }
+        if (const auto e = symbol->asEnum ()) {
+          if (!e->isScoped ()) {
+            collect (e, prefix);
+          }
+        }
+      }
+
+      std::multimap<QByteArray, QString> &names_;
+      const QString &fileName_;
+      Overview overview_;
+  };
+}
+
+struct SymbolIndex::Header {
+  quint32 magic;
+  quint32 version;
+  quint32 fileCount;
+  quint32 nameCount;
+};
+
+struct SymbolIndex::File {
+  quint32 pathOffset;
+  quint32 pathSize;
+  qint64 modified;
+};
+
+struct SymbolIndex::Name {
+  quint32 nameOffset;
+  quint32 nameSize;
+  quint32 file;
+};
+
+// layout: Header, File[fileCount], Name[nameCount] sorted by name, utf8 strings
+SymbolIndex::SymbolIndex (const QString &fileName) :
+  file_ (fileName),
+  data_ (nullptr),
+  size_ (0) {
+  map ();
+}
+
+SymbolIndex::~SymbolIndex () {
+  unmap ();
+}
+
+QStringList SymbolIndex::headers (const QString &name) const {
+  if (!data_) {
+    return {};
+  }
+
+  const auto header = reinterpret_cast<const Header *>(data_);
+  const auto files = reinterpret_cast<const File *>(header + 1);
+  const auto names = reinterpret_cast<const Name *>(files + header->fileCount);
+  const auto strings = reinterpret_cast<const char *>(names + header->nameCount);
+  const auto text = [strings](quint32 offset, quint32 size) {
+                      return QByteArray::fromRawData (strings + offset, int (size));
+                    };
+
+  const auto key = withoutTemplateArguments (name);
+  auto it = std::lower_bound (names, names + header->nameCount, key,
+                              [&text](const Name &l, const QByteArray &r) {
+    return text (l.nameOffset, l.nameSize) < r;
+  });
+
+  QStringList result;
+  for (; it != names + header->nameCount && text (it->nameOffset, it->nameSize) == key; ++it) {
+    const auto &file = files[it->file];
+    const auto path = QString::fromUtf8 (strings + file.pathOffset, int (file.pathSize));
+    if (modificationTime (path) == file.modified && !result.contains (path)) {
+      result.append (path);
+    }
+  }
+  return result;
+}
+
+QByteArray SymbolIndex::data () const {
+  return data_ ? QByteArray (reinterpret_cast<const char *>(data_), int (size_)) : QByteArray ();
+}
+
+bool SymbolIndex::replace (const QByteArray &data) {
+  unmap ();
+  QDir ().mkpath (QFileInfo (file_.fileName ()).absolutePath ());
+  QSaveFile file (file_.fileName ());
+  if (!file.open (QFile::WriteOnly) || file.write (data) != data.size () || !file.commit ()) {
+    map ();
+    return false;
+  }
+  return map ();
+}
+
+QByteArray SymbolIndex::build (const Snapshot &snapshot, const QByteArray &previous) {
+  std::multimap<QByteArray, QString> names;
+  QHash<QString, qint64> modified;
+  QSet<QString> indexed;
+
+  for (auto it = snapshot.begin (), end = snapshot.end (); it != end; ++it) {
+    const auto &document = it.value ();
+    const auto fileName = document->fileName ();
+    if (!CppTools::ProjectFile::isHeader (CppTools::ProjectFile::classify (fileName))
+        || !document->globalNamespace ()) {
+      continue;
+    }
+    indexed.insert (fileName);
+    modified.insert (fileName, modificationTime (fileName));
+    Collector (names, fileName).collect (document->globalNamespace (), {});
+  }
+
+  if (isValid (reinterpret_cast<const uchar *>(previous.constData ()), previous.size ())) {
+    const auto header = reinterpret_cast<const Header *>(previous.constData ());
+    const auto files = reinterpret_cast<const File *>(header + 1);
+    const auto oldNames = reinterpret_cast<const Name *>(files + header->fileCount);
+    const auto strings = reinterpret_cast<const char *>(oldNames + header->nameCount);
+    for (auto i = 0u; i < header->nameCount; ++i) {
+      const auto &file = files[oldNames[i].file];
+      const auto path = QString::fromUtf8 (strings + file.pathOffset, int (file.pathSize));
+      if (indexed.contains (path)) {
+        continue;
+      }
+      modified.insert (path, file.modified);
+      names.emplace (QByteArray (strings + oldNames[i].nameOffset, int (oldNames[i].nameSize)),
+                     path);
+    }
+  }
+
+  QByteArray strings;
+  QVector<File> files;
+  QHash<QString, quint32> fileIndexes;
+  for (auto it = modified.cbegin (), end = modified.cend (); it != end; ++it) {
+    const auto path = it.key ().toUtf8 ();
+    fileIndexes.insert (it.key (), quint32 (files.size ()));
+    files.append ({quint32 (strings.size ()), quint32 (path.size ()), it.value ()});
+    strings += path;
+  }
+
+  QVector<Name> records;
+  records.reserve (int (names.size ()));
+  QByteArray last;
+  quint32 lastOffset = 0;
+  for (const auto &i: names) {
+    if (records.isEmpty () || i.first != last) {
+      last = i.first;
+      lastOffset = quint32 (strings.size ());
+      strings += last;
+    }
+    records.append ({lastOffset, quint32 (last.size ()), fileIndexes.value (i.second)});
+  }
+
+  const Header header {indexMagic, indexVersion, quint32 (files.size ()), quint32 (records.size ())};
+  QByteArray result;
+  result.append (reinterpret_cast<const char *>(&header), sizeof (header));
+  result.append (reinterpret_cast<const char *>(files.constData ()),
+                 int (files.size () * sizeof (File)));
+  result.append (reinterpret_cast<const char *>(records.constData ()),
+                 int (records.size () * sizeof (Name)));
+  result.append (strings);
+  return result;
+}
+
+bool SymbolIndex::map () {
+  if (!file_.open (QFile::ReadOnly)) {
+    return false;
+  }
+  size_ = file_.size ();
+  data_ = size_ >= qint64 (sizeof (Header)) ? file_.map (0, size_) : nullptr;
+  if (!data_) {
+    unmap ();
+    return false;
+  }
+
+  if (!isValid (data_, size_)) {
+    unmap ();
+    return false;
+  }
+  return true;
+}
+
+// rejects files of other format, truncated or corrupted ones
+bool SymbolIndex::isValid (const uchar *data, qint64 size) {
+  if (!data || size < qint64 (sizeof (Header))) {
+    return false;
+  }
+  const auto header = reinterpret_cast<const Header *>(data);
+  const auto stringsOffset = qint64 (sizeof (Header)) + header->fileCount * qint64 (sizeof (File))
+                             + header->nameCount * qint64 (sizeof (Name));
+  if (header->magic != indexMagic || header->version != indexVersion || size < stringsOffset) {
+    return false;
+  }
+
+  const auto stringsSize = size - stringsOffset;
+  const auto isInStrings = [stringsSize](quint32 offset, quint32 length) {
+                             return qint64 (offset) + length <= stringsSize;
+                           };
+  const auto files = reinterpret_cast<const File *>(header + 1);
+  for (auto i = 0u; i < header->fileCount; ++i) {
+    if (!isInStrings (files[i].pathOffset, files[i].pathSize)) {
+      return false;
+    }
+  }
+  const auto names = reinterpret_cast<const Name *>(files + header->fileCount);
+  for (auto i = 0u; i < header->nameCount; ++i) {
+    if (!isInStrings (names[i].nameOffset, names[i].nameSize) || names[i].file >= header->fileCount) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void SymbolIndex::unmap () {
+  if (data_) {
+    file_.unmap (data_);
+  }
+  file_.close ();
+  data_ = nullptr;
+  size_ = 0;
+}
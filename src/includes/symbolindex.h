@@ -0,0 +1,40 @@
+#pragma once
+
+#include <QFile>
+
+namespace CPlusPlus {
+  class Snapshot;
+}
+
+// Persistent index of names declared in headers, used to suggest headers
+// for names that can not be resolved through the snapshot.
+// Kept in a memory mapped file, so it is available right after start.
+// Names are stored both fully qualified and unqualified.
+// Not thread safe, except static build.
+class SymbolIndex {
+  public:
+    explicit SymbolIndex (const QString &fileName);
+    ~SymbolIndex ();
+
+    // headers declaring name, which were not modified since indexing
+    QStringList headers (const QString &name) const;
+
+    QByteArray data () const;
+    bool replace (const QByteArray &data);
+
+    // indexes headers of snapshot, keeping previous data of other files
+    static QByteArray build (const CPlusPlus::Snapshot &snapshot, const QByteArray &previous);
+
+  private:
+    struct Header;
+    struct File;
+    struct Name;
+
+    static bool isValid (const uchar *data, qint64 size);
+    bool map ();
+    void unmap ();
+
+    mutable QFile file_;
+    uchar *data_;
+    qint64 size_;
+};